@@ -0,0 +1,809 @@
+/**
+ * wayfire-bench: a stress benchmark for the compositor.
+ *
+ * Starts wayfire on the headless backend and connects a number of
+ * synthetic xdg-shell clients to it, each on its own thread. The clients
+ * commit new content at a fixed rate, with a configurable damage pattern
+ * and depth of subsurfaces, and request presentation feedback for every
+ * commit. At the end, the compositor CPU time per frame, frame times and
+ * commit-to-present latencies are reported.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <wayland-client.h>
+#include "xdg-shell-client-protocol.h"
+#include "presentation-time-client-protocol.h"
+
+namespace
+{
+enum damage_pattern_t
+{
+    /* Damage and redraw the whole surface */
+    DAMAGE_FULL,
+    /* A small square moving over the surface */
+    DAMAGE_PARTIAL,
+    /* Several small squares at random positions */
+    DAMAGE_SCATTERED,
+    /* Commit without damage */
+    DAMAGE_NONE,
+};
+
+struct bench_options_t
+{
+    int clients = 4;
+    int width = 512;
+    int height = 512;
+    double rate = 60;
+    damage_pattern_t damage = DAMAGE_PARTIAL;
+    int subsurface_depth = 0;
+    int duration = 10;
+    std::string wayfire = "wayfire";
+    std::string config;
+};
+
+/** Results collected by all clients during the measurement */
+struct bench_results_t
+{
+    std::mutex lock;
+    bool measuring = false;
+
+    uint64_t commits = 0;
+    uint64_t skipped = 0;
+    uint64_t presented = 0;
+    uint64_t discarded = 0;
+
+    /* Commit-to-present latencies, in microseconds */
+    std::vector<int64_t> latencies;
+    /* Distinct presentation times, i.e output frames, in microseconds */
+    std::set<int64_t> frames;
+};
+
+int64_t get_time_us(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+int64_t get_percentile(std::vector<int64_t>& values, double percentile)
+{
+    if (values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    size_t index = (values.size() - 1) * percentile / 100.0;
+    return values[index];
+}
+
+double get_average(const std::vector<int64_t>& values)
+{
+    if (values.empty())
+        return 0;
+
+    double sum = 0;
+    for (auto v : values)
+        sum += v;
+
+    return sum / values.size();
+}
+
+struct shm_buffer_t
+{
+    wl_buffer *buffer = nullptr;
+    uint32_t *data = nullptr;
+    size_t size = 0;
+    bool busy = false;
+};
+
+/** A wl_surface with its buffers, either the toplevel or a subsurface */
+struct client_surface_t
+{
+    wl_surface *surface = nullptr;
+    wl_subsurface *subsurface = nullptr;
+    int width, height;
+    shm_buffer_t buffers[2];
+};
+
+class synthetic_client_t
+{
+  public:
+    synthetic_client_t(const bench_options_t& options, bench_results_t& results,
+        int index) : options(options), results(results), index(index) { }
+
+    /** Connect to the compositor and create the surfaces */
+    bool init(const std::string& socket)
+    {
+        display = wl_display_connect(socket.c_str());
+        if (!display)
+        {
+            std::fprintf(stderr, "client %d: failed to connect to %s\n",
+                index, socket.c_str());
+            return false;
+        }
+
+        registry = wl_display_get_registry(display);
+        wl_registry_add_listener(registry, &registry_listener, this);
+        wl_display_roundtrip(display);
+
+        if (!compositor || !subcompositor || !shm || !wm_base)
+        {
+            std::fprintf(stderr, "client %d: missing globals\n", index);
+            return false;
+        }
+
+        if (!presentation)
+            std::fprintf(stderr, "client %d: no wp_presentation\n", index);
+
+        xdg_wm_base_add_listener(wm_base, &wm_base_listener, this);
+        create_surfaces();
+
+        while (!configured)
+        {
+            if (wl_display_dispatch(display) < 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    ~synthetic_client_t()
+    {
+        if (display)
+            wl_display_disconnect(display);
+    }
+
+    /** Commit frames until running is set to false */
+    void run(const std::atomic<bool>& running)
+    {
+        int64_t period = 1000000 / std::max(options.rate, 0.001);
+        int64_t next_commit = get_time_us(CLOCK_MONOTONIC);
+
+        int fd = wl_display_get_fd(display);
+        while (running)
+        {
+            int64_t now = get_time_us(CLOCK_MONOTONIC);
+            if (now >= next_commit)
+            {
+                commit_frame();
+                next_commit += period;
+                /* Don't try to catch up if we fell behind */
+                if (next_commit < now)
+                    next_commit = now + period;
+            }
+
+            while (wl_display_prepare_read(display) != 0)
+                wl_display_dispatch_pending(display);
+            wl_display_flush(display);
+
+            pollfd pfd = {fd, POLLIN, 0};
+            int timeout = std::max<int64_t>(next_commit - now, 0) / 1000;
+            if (poll(&pfd, 1, std::min(timeout, 100)) > 0)
+            {
+                if (wl_display_read_events(display) < 0)
+                    return;
+            } else
+            {
+                wl_display_cancel_read(display);
+            }
+
+            if (wl_display_dispatch_pending(display) < 0)
+                return;
+        }
+    }
+
+  private:
+    const bench_options_t& options;
+    bench_results_t& results;
+    int index;
+
+    wl_display *display = nullptr;
+    wl_registry *registry = nullptr;
+    wl_compositor *compositor = nullptr;
+    wl_subcompositor *subcompositor = nullptr;
+    wl_shm *shm = nullptr;
+    xdg_wm_base *wm_base = nullptr;
+    wp_presentation *presentation = nullptr;
+    clockid_t presentation_clock = CLOCK_MONOTONIC;
+
+    struct xdg_surface *xsurface = nullptr;
+    xdg_toplevel *toplevel = nullptr;
+    bool configured = false;
+
+    /* The toplevel first, then the subsurfaces, each a child of the
+     * previous one */
+    std::vector<client_surface_t> surfaces;
+    uint32_t frame_count = 0;
+    unsigned int seed = index;
+
+    struct feedback_data_t
+    {
+        synthetic_client_t *client;
+        int64_t commit_time;
+    };
+
+    void create_surfaces()
+    {
+        /* Buffers are referenced by their listeners, so don't reallocate */
+        surfaces.reserve(options.subsurface_depth + 1);
+
+        int width = options.width, height = options.height;
+        for (int i = 0; i <= options.subsurface_depth; i++)
+        {
+            surfaces.emplace_back();
+            auto& surface = surfaces.back();
+            surface.surface = wl_compositor_create_surface(compositor);
+            surface.width = std::max(width, 16);
+            surface.height = std::max(height, 16);
+
+            if (i == 0)
+            {
+                xsurface = xdg_wm_base_get_xdg_surface(wm_base,
+                    surface.surface);
+                xdg_surface_add_listener(xsurface, &surface_listener, this);
+                toplevel = xdg_surface_get_toplevel(xsurface);
+                xdg_toplevel_set_title(toplevel, "wayfire-bench");
+            } else
+            {
+                surface.subsurface = wl_subcompositor_get_subsurface(
+                    subcompositor, surface.surface, surfaces[i - 1].surface);
+                wl_subsurface_set_position(surface.subsurface, 16, 16);
+                wl_subsurface_set_desync(surface.subsurface);
+            }
+
+            for (auto& buffer : surface.buffers)
+                create_buffer(buffer, surface.width, surface.height);
+
+            width -= 32;
+            height -= 32;
+        }
+
+        wl_surface_commit(surfaces[0].surface);
+    }
+
+    void create_buffer(shm_buffer_t& buffer, int width, int height)
+    {
+        int stride = width * 4;
+        buffer.size = stride * height;
+
+        int fd = memfd_create("wayfire-bench", MFD_CLOEXEC);
+        if (fd < 0 || ftruncate(fd, buffer.size) < 0)
+        {
+            std::perror("failed to create shm buffer");
+            std::exit(EXIT_FAILURE);
+        }
+
+        buffer.data = (uint32_t*)mmap(NULL, buffer.size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        std::memset(buffer.data, 0xff, buffer.size);
+
+        auto pool = wl_shm_create_pool(shm, fd, buffer.size);
+        buffer.buffer = wl_shm_pool_create_buffer(pool, 0, width, height,
+            stride, WL_SHM_FORMAT_XRGB8888);
+        wl_buffer_add_listener(buffer.buffer, &buffer_listener, &buffer);
+        wl_shm_pool_destroy(pool);
+        close(fd);
+    }
+
+    void fill(client_surface_t& surface, shm_buffer_t& buffer,
+        int x, int y, int width, int height, uint32_t color)
+    {
+        x = std::max(x, 0);
+        y = std::max(y, 0);
+        width = std::min(width, surface.width - x);
+        height = std::min(height, surface.height - y);
+
+        for (int j = y; j < y + height; j++)
+        {
+            std::fill_n(buffer.data + j * surface.width + x, width, color);
+        }
+
+        wl_surface_damage_buffer(surface.surface, x, y, width, height);
+    }
+
+    void draw(client_surface_t& surface, shm_buffer_t& buffer)
+    {
+        uint32_t color = 0xff000000 | ((frame_count * 2654435761u) >> 8);
+        const int square = 64;
+
+        switch (options.damage)
+        {
+          case DAMAGE_FULL:
+            fill(surface, buffer, 0, 0, surface.width, surface.height, color);
+            break;
+
+          case DAMAGE_PARTIAL:
+          {
+            int steps_x = std::max(surface.width / square, 1);
+            int steps_y = std::max(surface.height / square, 1);
+            int pos = frame_count % (steps_x * steps_y);
+            fill(surface, buffer, (pos % steps_x) * square,
+                (pos / steps_x) * square, square, square, color);
+            break;
+          }
+
+          case DAMAGE_SCATTERED:
+            for (int i = 0; i < 8; i++)
+            {
+                fill(surface, buffer, rand_r(&seed) % surface.width,
+                    rand_r(&seed) % surface.height, square / 4, square / 4,
+                    color);
+            }
+            break;
+
+          case DAMAGE_NONE:
+            break;
+        }
+    }
+
+    void commit_frame()
+    {
+        ++frame_count;
+
+        /* Subsurfaces first, so that the toplevel commit shows them too */
+        for (int i = surfaces.size() - 1; i >= 0; i--)
+        {
+            auto& surface = surfaces[i];
+            auto it = std::find_if(std::begin(surface.buffers),
+                std::end(surface.buffers),
+                [] (const shm_buffer_t& buffer) { return !buffer.busy; });
+
+            if (it == std::end(surface.buffers))
+            {
+                if (i == 0)
+                    count(results.skipped);
+                continue;
+            }
+
+            /* The two buffers aren't kept in sync, which doesn't matter
+             * for the compositor's workload */
+            draw(surface, *it);
+            it->busy = true;
+            wl_surface_attach(surface.surface, it->buffer, 0, 0);
+
+            if (i == 0 && presentation)
+            {
+                auto feedback = wp_presentation_feedback(presentation,
+                    surface.surface);
+                wp_presentation_feedback_add_listener(feedback,
+                    &feedback_listener, new feedback_data_t{this,
+                        get_time_us(presentation_clock)});
+                count(results.commits);
+            }
+
+            wl_surface_commit(surface.surface);
+        }
+    }
+
+    void count(uint64_t& counter)
+    {
+        std::lock_guard<std::mutex> guard(results.lock);
+        if (results.measuring)
+            ++counter;
+    }
+
+    /* Listeners */
+    static void handle_global(void *data, wl_registry *registry,
+        uint32_t name, const char *interface, uint32_t version)
+    {
+        auto client = static_cast<synthetic_client_t*> (data);
+        std::string iface = interface;
+
+        if (iface == wl_compositor_interface.name)
+        {
+            client->compositor = (wl_compositor*)wl_registry_bind(registry,
+                name, &wl_compositor_interface, std::min(version, 4u));
+        } else if (iface == wl_subcompositor_interface.name)
+        {
+            client->subcompositor = (wl_subcompositor*)wl_registry_bind(
+                registry, name, &wl_subcompositor_interface, 1);
+        } else if (iface == wl_shm_interface.name)
+        {
+            client->shm = (wl_shm*)wl_registry_bind(registry, name,
+                &wl_shm_interface, 1);
+        } else if (iface == xdg_wm_base_interface.name)
+        {
+            client->wm_base = (xdg_wm_base*)wl_registry_bind(registry, name,
+                &xdg_wm_base_interface, 1);
+        } else if (iface == wp_presentation_interface.name)
+        {
+            client->presentation = (wp_presentation*)wl_registry_bind(
+                registry, name, &wp_presentation_interface, 1);
+            wp_presentation_add_listener(client->presentation,
+                &presentation_listener, client);
+        }
+    }
+
+    static void handle_global_remove(void*, wl_registry*, uint32_t) { }
+
+    static void handle_ping(void*, xdg_wm_base *wm_base, uint32_t serial)
+    {
+        xdg_wm_base_pong(wm_base, serial);
+    }
+
+    static void handle_configure(void *data, struct xdg_surface *surface,
+        uint32_t serial)
+    {
+        auto client = static_cast<synthetic_client_t*> (data);
+        xdg_surface_ack_configure(surface, serial);
+        client->configured = true;
+    }
+
+    static void handle_clock_id(void *data, wp_presentation*, uint32_t clock)
+    {
+        static_cast<synthetic_client_t*> (data)->presentation_clock = clock;
+    }
+
+    static void handle_release(void *data, wl_buffer*)
+    {
+        static_cast<shm_buffer_t*> (data)->busy = false;
+    }
+
+    static void handle_sync_output(void*, wp_presentation_feedback*, wl_output*) { }
+
+    static void handle_presented(void *data, wp_presentation_feedback *feedback,
+        uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+        uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+    {
+        auto fd = static_cast<feedback_data_t*> (data);
+        int64_t sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo;
+        int64_t presented = sec * 1000000 + tv_nsec / 1000;
+
+        auto& results = fd->client->results;
+        {
+            std::lock_guard<std::mutex> guard(results.lock);
+            if (results.measuring)
+            {
+                ++results.presented;
+                results.latencies.push_back(presented - fd->commit_time);
+                results.frames.insert(presented);
+            }
+        }
+
+        wp_presentation_feedback_destroy(feedback);
+        delete fd;
+    }
+
+    static void handle_discarded(void *data, wp_presentation_feedback *feedback)
+    {
+        auto fd = static_cast<feedback_data_t*> (data);
+        fd->client->count(fd->client->results.discarded);
+        wp_presentation_feedback_destroy(feedback);
+        delete fd;
+    }
+
+    static const wl_registry_listener registry_listener;
+    static const xdg_wm_base_listener wm_base_listener;
+    static const xdg_surface_listener surface_listener;
+    static const wp_presentation_listener presentation_listener;
+    static const wp_presentation_feedback_listener feedback_listener;
+    static const wl_buffer_listener buffer_listener;
+};
+
+const wl_registry_listener synthetic_client_t::registry_listener = {
+    handle_global, handle_global_remove};
+const xdg_wm_base_listener synthetic_client_t::wm_base_listener = {
+    handle_ping};
+const xdg_surface_listener synthetic_client_t::surface_listener = {
+    handle_configure};
+const wp_presentation_listener synthetic_client_t::presentation_listener = {
+    handle_clock_id};
+const wp_presentation_feedback_listener synthetic_client_t::feedback_listener = {
+    handle_sync_output, handle_presented, handle_discarded};
+const wl_buffer_listener synthetic_client_t::buffer_listener = {
+    handle_release};
+
+/** @return The names of the wayland sockets in the runtime dir */
+std::set<std::string> list_sockets(const std::string& runtime_dir)
+{
+    std::set<std::string> sockets;
+    DIR *dir = opendir(runtime_dir.c_str());
+    if (!dir)
+        return sockets;
+
+    while (auto entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name.compare(0, 8, "wayland-") == 0 &&
+            name.find(".lock") == std::string::npos)
+        {
+            sockets.insert(name);
+        }
+    }
+
+    closedir(dir);
+    return sockets;
+}
+
+/** @return The CPU time (user + system) used by the process, in ms */
+double get_cpu_time(pid_t pid)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+
+    /* The process name may contain spaces, skip over it */
+    auto pos = line.rfind(')');
+    if (pos == std::string::npos)
+        return 0;
+
+    /* utime and stime are fields 14 and 15, the name is field 2 */
+    char state;
+    long long skip, utime, stime;
+    int read = std::sscanf(line.c_str() + pos + 1,
+        " %c %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+        &state, &skip, &skip, &skip, &skip, &skip, &skip, &skip, &skip,
+        &skip, &skip, &utime, &stime);
+    if (read != 13)
+        return 0;
+
+    return (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+}
+
+pid_t start_compositor(const bench_options_t& options)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    setenv("WLR_BACKENDS", "headless", 1);
+    setenv("WLR_HEADLESS_OUTPUTS", "1", 1);
+    setenv("WLR_LIBINPUT_NO_DEVICES", "1", 1);
+    unsetenv("WAYLAND_DISPLAY");
+    unsetenv("DISPLAY");
+
+    std::vector<const char*> args = {options.wayfire.c_str()};
+    if (!options.config.empty())
+    {
+        args.push_back("-c");
+        args.push_back(options.config.c_str());
+    }
+    args.push_back(nullptr);
+
+    execvp(args[0], (char* const*)args.data());
+    std::perror("failed to start wayfire");
+    _exit(EXIT_FAILURE);
+}
+
+/** Wait for a new wayland socket to appear. @return its name or "" */
+std::string wait_for_socket(pid_t pid, const std::string& runtime_dir,
+    const std::set<std::string>& old_sockets)
+{
+    for (int i = 0; i < 100; i++)
+    {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+            return "";
+
+        for (auto& socket : list_sockets(runtime_dir))
+        {
+            if (!old_sockets.count(socket))
+                return socket;
+        }
+
+        usleep(100000);
+    }
+
+    return "";
+}
+
+void print_usage(const char *name)
+{
+    std::printf("Usage: %s [options]\n"
+        "  -n, --clients N        number of clients (4)\n"
+        "  -s, --size WxH         size of each client (512x512)\n"
+        "  -r, --rate HZ          commits per second per client (60)\n"
+        "  -d, --damage PATTERN   full, partial, scattered or none (partial)\n"
+        "  -S, --subsurfaces N    depth of nested subsurfaces (0)\n"
+        "  -t, --duration SEC     length of the measurement (10)\n"
+        "  -w, --wayfire PATH     the wayfire binary (wayfire)\n"
+        "  -c, --config FILE      the config file for wayfire\n", name);
+}
+
+bool parse_options(int argc, char **argv, bench_options_t& options)
+{
+    struct option opts[] = {
+        {"clients",     required_argument, NULL, 'n'},
+        {"size",        required_argument, NULL, 's'},
+        {"rate",        required_argument, NULL, 'r'},
+        {"damage",      required_argument, NULL, 'd'},
+        {"subsurfaces", required_argument, NULL, 'S'},
+        {"duration",    required_argument, NULL, 't'},
+        {"wayfire",     required_argument, NULL, 'w'},
+        {"config",      required_argument, NULL, 'c'},
+        {"help",        no_argument,       NULL, 'h'},
+        {0,             0,                 NULL,  0 }
+    };
+
+    int c, i;
+    while ((c = getopt_long(argc, argv, "n:s:r:d:S:t:w:c:h", opts, &i)) != -1)
+    {
+        std::string arg = optarg ? optarg : "";
+        switch (c)
+        {
+          case 'n':
+            options.clients = std::max(std::atoi(optarg), 1);
+            break;
+          case 's':
+            if (std::sscanf(optarg, "%dx%d", &options.width,
+                    &options.height) != 2)
+            {
+                return false;
+            }
+            break;
+          case 'r':
+            options.rate = std::atof(optarg);
+            break;
+          case 'd':
+            if (arg == "full")
+                options.damage = DAMAGE_FULL;
+            else if (arg == "partial")
+                options.damage = DAMAGE_PARTIAL;
+            else if (arg == "scattered")
+                options.damage = DAMAGE_SCATTERED;
+            else if (arg == "none")
+                options.damage = DAMAGE_NONE;
+            else
+                return false;
+            break;
+          case 'S':
+            options.subsurface_depth = std::max(std::atoi(optarg), 0);
+            break;
+          case 't':
+            options.duration = std::max(std::atoi(optarg), 1);
+            break;
+          case 'w':
+            options.wayfire = optarg;
+            break;
+          case 'c':
+            options.config = optarg;
+            break;
+          default:
+            return false;
+        }
+    }
+
+    return options.rate > 0 && options.width > 0 && options.height > 0;
+}
+
+void print_report(const bench_options_t& options, bench_results_t& results,
+    double cpu_ms, double elapsed_ms)
+{
+    std::vector<int64_t> frame_times;
+    int64_t last = -1;
+    for (auto time : results.frames)
+    {
+        if (last >= 0)
+            frame_times.push_back(time - last);
+        last = time;
+    }
+
+    size_t frames = results.frames.size();
+    std::printf("clients: %d, size: %dx%d, rate: %.1fHz, subsurfaces: %d\n",
+        options.clients, options.width, options.height, options.rate,
+        options.subsurface_depth);
+    std::printf("duration:    %.1fs\n", elapsed_ms / 1000.0);
+    std::printf("commits:     %lu (%lu skipped, no free buffer)\n",
+        (unsigned long)results.commits, (unsigned long)results.skipped);
+    std::printf("presented:   %lu, discarded: %lu\n",
+        (unsigned long)results.presented, (unsigned long)results.discarded);
+    std::printf("frames:      %zu (%.1f fps)\n", frames,
+        frames * 1000.0 / elapsed_ms);
+    std::printf("cpu:         %.1fms total, %.3fms per frame, %.1f%% load\n",
+        cpu_ms, frames ? cpu_ms / frames : 0.0, 100.0 * cpu_ms / elapsed_ms);
+    std::printf("frame time:  avg %.2fms, p50 %.2fms, p99 %.2fms, max %.2fms\n",
+        get_average(frame_times) / 1000.0,
+        get_percentile(frame_times, 50) / 1000.0,
+        get_percentile(frame_times, 99) / 1000.0,
+        get_percentile(frame_times, 100) / 1000.0);
+    std::printf("latency:     avg %.2fms, p50 %.2fms, p99 %.2fms, max %.2fms\n",
+        get_average(results.latencies) / 1000.0,
+        get_percentile(results.latencies, 50) / 1000.0,
+        get_percentile(results.latencies, 99) / 1000.0,
+        get_percentile(results.latencies, 100) / 1000.0);
+}
+}
+
+int main(int argc, char **argv)
+{
+    bench_options_t options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (!runtime_dir)
+    {
+        std::fprintf(stderr, "XDG_RUNTIME_DIR is not set\n");
+        return EXIT_FAILURE;
+    }
+
+    auto old_sockets = list_sockets(runtime_dir);
+    pid_t pid = start_compositor(options);
+    auto socket = wait_for_socket(pid, runtime_dir, old_sockets);
+    if (socket.empty())
+    {
+        std::fprintf(stderr, "wayfire didn't start\n");
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return EXIT_FAILURE;
+    }
+
+    bench_results_t results;
+    std::atomic<bool> running{true};
+    std::atomic<int> ready{0}, failed{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.clients; i++)
+    {
+        threads.emplace_back([&, i] ()
+        {
+            synthetic_client_t client(options, results, i);
+            if (!client.init(socket))
+            {
+                ++failed;
+                return;
+            }
+
+            ++ready;
+            client.run(running);
+        });
+    }
+
+    while (ready + failed < options.clients)
+        usleep(10000);
+
+    /* Let the compositor settle after mapping the clients */
+    usleep(500000);
+
+    int64_t start = get_time_us(CLOCK_MONOTONIC);
+    double cpu_start = get_cpu_time(pid);
+    {
+        std::lock_guard<std::mutex> guard(results.lock);
+        results.measuring = true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+
+    {
+        std::lock_guard<std::mutex> guard(results.lock);
+        results.measuring = false;
+    }
+    double cpu_end = get_cpu_time(pid);
+    int64_t end = get_time_us(CLOCK_MONOTONIC);
+
+    running = false;
+    for (auto& thread : threads)
+        thread.join();
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+
+    if (failed)
+        std::fprintf(stderr, "%d clients failed to start\n", (int)failed);
+
+    print_report(options, results, cpu_end - cpu_start, (end - start) / 1000.0);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -13,7 +13,7 @@
 #include "../matcher/matcher.hpp"
 
 void animation_base::init(wayfire_view, wf_option, wf_animation_type) {}
-bool animation_base::step() {return false;}
+bool animation_base::step(uint32_t) {return false;}
 animation_base::~animation_base() {}
 
 /* Represents an animation running for a specific view
@@ -33,14 +33,19 @@ struct animation_hook : public wf::custom_data_t
     wf::output_t *output;
 
     /* Update animation right before each frame */
-    wf::effect_hook_t update_animation_hook = [=] ()
+    wf::frame_callback_t update_animation_hook = [=] (uint32_t frame_time)
     {
         view->damage();
-        bool result = animation->step();
+        bool result = animation->step(frame_time);
         view->damage();
 
         if (!result)
+        {
             stop_hook(false);
+            return false;
+        }
+
+        return true;
     };
 
     /* If the view changes outputs, we need to stop animating, because our animations,
@@ -66,7 +71,7 @@ struct animation_hook : public wf::custom_data_t
         animation = std::make_unique<animation_t> ();
         animation->init(view, duration, type);
 
-        output->render->add_effect(&update_animation_hook, wf::OUTPUT_EFFECT_PRE);
+        output->render->add_animation(&update_animation_hook);
 
         /* We listen for just the detach-view signal. If the state changes in
          * some other way (i.e view unmapped while map animation), the hook
@@ -89,7 +94,7 @@ struct animation_hook : public wf::custom_data_t
         if (type == ANIMATION_TYPE_UNMAP)
             view->unref();
 
-        output->render->rem_effect(&update_animation_hook);
+        output->render->rem_animation(&update_animation_hook);
         output->disconnect_signal("detach-view", &view_detached);
     }
 };
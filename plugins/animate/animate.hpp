@@ -3,6 +3,7 @@
 
 #include <view.hpp>
 #include <animation.hpp>
+#include <frame-duration.hpp>
 
 #define HIDING_ANIMATION (1 << 0)
 #define SHOWING_ANIMATION (1 << 1)
@@ -21,7 +22,8 @@ class animation_base
 {
     public:
     virtual void init(wayfire_view view, wf_option duration, wf_animation_type type);
-    virtual bool step(); /* return true if continue, false otherwise */
+    /* Advance to the given frame time, return true if continue, false otherwise */
+    virtual bool step(uint32_t frame_time);
     virtual ~animation_base();
 };
 
@@ -4,13 +4,14 @@
 #include <opengl.hpp>
 #include <view-transform.hpp>
 #include <output.hpp>
+#include <render-manager.hpp>
 
 class fade_animation : public animation_base
 {
     wayfire_view view;
 
     float start = 0, end = 1;
-    wf_duration duration;
+    wf::frame_duration_t duration;
     std::string name;
 
     public:
@@ -18,8 +19,8 @@ class fade_animation : public animation_base
     void init(wayfire_view view, wf_option dur, wf_animation_type type) override
     {
         this->view = view;
-        duration = wf_duration(dur);
-        duration.start();
+        duration = wf::frame_duration_t(dur);
+        duration.start(view->get_output()->render->get_frame_time());
 
         if (type & HIDING_ANIMATION)
             std::swap(start, end);
@@ -28,8 +29,9 @@ class fade_animation : public animation_base
         view->add_transformer(std::make_unique<wf_2D_view> (view), name);
     }
 
-    bool step() override
+    bool step(uint32_t frame_time) override
     {
+        duration.set_frame_time(frame_time);
         auto transform = dynamic_cast<wf_2D_view*> (view->get_transformer(name).get());
         transform->alpha = duration.progress(start, end);
         return duration.running();
@@ -48,15 +50,15 @@ class zoom_animation : public animation_base
 
     wf_transition alpha {0, 1}, zoom {1./3, 1},
                   offset_x{0, 0}, offset_y{0, 0};
-    wf_duration duration;
+    wf::frame_duration_t duration;
 
     public:
 
     void init(wayfire_view view, wf_option dur, wf_animation_type type) override
     {
         this->view = view;
-        duration = wf_duration(dur);
-        duration.start();
+        duration = wf::frame_duration_t(dur);
+        duration.start(view->get_output()->render->get_frame_time());
 
         if (type & MINIMIZE_STATE_ANIMATION)
         {
@@ -94,8 +96,9 @@ class zoom_animation : public animation_base
         view->add_transformer(std::unique_ptr<wf_2D_view> (our_transform));
     }
 
-    bool step() override
+    bool step(uint32_t frame_time) override
     {
+        duration.set_frame_time(frame_time);
         float c = duration.progress(zoom);
 
         our_transform->alpha = duration.progress(alpha);
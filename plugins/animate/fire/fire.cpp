@@ -3,6 +3,7 @@
 
 #include <thread>
 #include <output.hpp>
+#include <render-manager.hpp>
 #include <core.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -129,13 +130,14 @@ void FireAnimation::init(wayfire_view view, wf_option dur, wf_animation_type typ
 
     int msec = dur->as_int() * fire_duration_mod_for_height(
         view->get_bounding_box().height);
-    this->duration = wf_duration(new_static_option(std::to_string(msec)),
-                                 wf_animation::linear);
+    this->duration = wf::frame_duration_t(
+        new_static_option(std::to_string(msec)), wf_animation::linear);
 
+    uint32_t frame_time = view->get_output()->render->get_frame_time();
     if (type & HIDING_ANIMATION) {
-        duration.start(1, 0);
+        duration.start(frame_time, 1, 0);
     } else {
-        duration.start(0, 1);
+        duration.start(frame_time, 0, 1);
     }
 
     name = "animation-fire-" + std::to_string(type);
@@ -145,13 +147,14 @@ void FireAnimation::init(wayfire_view view, wf_option dur, wf_animation_type typ
     view->add_transformer(std::move(tr), name);
 }
 
-bool FireAnimation::step()
+bool FireAnimation::step(uint32_t frame_time)
 {
+    duration.set_frame_time(frame_time);
     transformer->set_progress_line(duration.progress());
     if (duration.running())
         transformer->ps.spawn(transformer->ps.size() / 10);
 
-    transformer->ps.update();
+    transformer->ps.update(frame_time);
     return duration.running() || transformer->ps.statistic();
 }
 
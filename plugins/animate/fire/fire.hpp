@@ -13,7 +13,7 @@ class FireAnimation : public animation_base
     std::string name; // the name of the transformer in the view's table
     wayfire_view view;
     nonstd::observer_ptr<FireTransformer> transformer;
-    wf_duration duration;
+    wf::frame_duration_t duration;
 
     public:
 
@@ -21,7 +21,7 @@ class FireAnimation : public animation_base
 
     ~FireAnimation();
     void init(wayfire_view view, wf_option duration, wf_animation_type type) override;
-    bool step() override; /* return true if continue, false otherwise */
+    bool step(uint32_t frame_time) override; /* return true if continue, false otherwise */
 };
 
 #endif /* end of include guard: FIRE_ANIMATION_HPP */
@@ -2,6 +2,7 @@
 #include "shaders.hpp"
 #include <core.hpp>
 #include <thread>
+#include <algorithm>
 #include <debug.hpp>
 
 void Particle::update(float time)
@@ -142,11 +143,14 @@ void ParticleSystem::exec_worker_threads(std::function<void(int, int)> spawn_wor
         w.join();
 }
 
-void ParticleSystem::update()
+void ParticleSystem::update(uint32_t frame_time)
 {
-    // FIXME: don't hardcode 60FPS
-    float time = (get_current_time() - last_update_msec) / 16.0;
-    last_update_msec = get_current_time();
+    /* The simulation step is tuned for 60FPS, so scale it to the actual
+     * time between frames */
+    float time = 0;
+    if (frame_time > last_update_msec)
+        time = (frame_time - last_update_msec) / (1000.0 / 60);
+    last_update_msec = std::max(last_update_msec, frame_time);
 
     exec_worker_threads([=] (int start, int end) {
         update_worker(time, start, end);
@@ -178,7 +182,7 @@ void ParticleSystem::create_program()
 
 void ParticleSystem::render(glm::mat4 matrix)
 {
-    GL_CALL(glUseProgram(program.id));
+    OpenGL::use_program(program.id);
 
     static float vertex_data[] = {
         -1, -1,
@@ -215,8 +219,8 @@ void ParticleSystem::render(glm::mat4 matrix)
     GL_CALL(glVertexAttribPointer(program.color, 4, GL_FLOAT,
                                   false, 0, dark_color.data()));
 
-    GL_CALL(glEnable(GL_BLEND));
-    GL_CALL(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
+    OpenGL::enable(GL_BLEND);
+    OpenGL::blend_func(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
     GL_CALL(glUniform1f(program.smoothing, 0.7f));
     // TODO: optimize shaders for this case
     GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
@@ -224,11 +228,11 @@ void ParticleSystem::render(glm::mat4 matrix)
     // particle color
     GL_CALL(glVertexAttribPointer(program.color, 4, GL_FLOAT,
                                   false, 0, color.data()));
-    GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+    OpenGL::blend_func(GL_SRC_ALPHA, GL_ONE);
     GL_CALL(glUniform1f(program.smoothing, 0.5f));
     GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
 
-    GL_CALL(glDisable(GL_BLEND));
+    OpenGL::disable(GL_BLEND);
 
     // reset vertex attrib state, other renderers may need this
     GL_CALL(glVertexAttribDivisor(program.position, 0));
@@ -236,8 +240,8 @@ void ParticleSystem::render(glm::mat4 matrix)
     GL_CALL(glVertexAttribDivisor(program.center, 0));
     GL_CALL(glVertexAttribDivisor(program.color, 0));
 
-    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
-    GL_CALL(glUseProgram(0));
+    OpenGL::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    OpenGL::use_program(0);
 
     GL_CALL(glDisableVertexAttribArray(program.position));
     GL_CALL(glDisableVertexAttribArray(program.radius));
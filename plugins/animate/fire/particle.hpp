@@ -47,8 +47,8 @@ class ParticleSystem
         // return the maximal number of particles
         int size();
 
-        /* update all particles */
-        void update();
+        /* update all particles to the given time, in milliseconds */
+        void update(uint32_t frame_time);
 
         // number of particles alive
         int statistic();
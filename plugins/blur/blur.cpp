@@ -260,7 +260,7 @@ class wayfire_blur : public wf::plugin_interface_t
              * from last frame at this point. We are writing them
              * to saved_pixels, bound as GL_DRAW_FRAMEBUFFER */
             saved_pixels.bind();
-            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, target_fb.fb));
+            OpenGL::bind_framebuffer(GL_READ_FRAMEBUFFER, target_fb.fb);
 
             /* Copy pixels in padded_region from target_fb to saved_pixels. */
             for (const auto& rect : padded_region)
@@ -278,7 +278,7 @@ class wayfire_blur : public wf::plugin_interface_t
 
             /* This effectively makes damage the same as expanded_damage. */
             damage |= expanded_damage;
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+            OpenGL::bind_texture(GL_TEXTURE_2D, 0);
             OpenGL::render_end();
         };
 
@@ -296,7 +296,7 @@ class wayfire_blur : public wf::plugin_interface_t
              * rendered with expanded damage and artifacts on the edges.
              * saved_pixels has the the padded region of pixels to overwrite the
              * artifacts that blurring has left behind. */
-            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, saved_pixels.fb));
+            OpenGL::bind_framebuffer(GL_READ_FRAMEBUFFER, saved_pixels.fb);
 
             /* Copy pixels back from saved_pixels to target_fb. */
             for (const auto& rect : padded_region)
@@ -313,7 +313,7 @@ class wayfire_blur : public wf::plugin_interface_t
 
             /* Reset stuff */
             padded_region.clear();
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+            OpenGL::bind_texture(GL_TEXTURE_2D, 0);
             OpenGL::render_end();
         };
 
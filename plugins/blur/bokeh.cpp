@@ -95,23 +95,23 @@ class wf_bokeh_blur : public wf_blur_base
 
         OpenGL::render_begin();
         /* Upload data to shader */
-        GL_CALL(glUseProgram(program[0]));
+        OpenGL::use_program(program[0]);
         GL_CALL(glUniform2f(halfpixelID, 0.5f / width, 0.5f / height));
         GL_CALL(glUniform1f(offsetID, offset));
         GL_CALL(glUniform1i(iterID, iterations));
 
         GL_CALL(glVertexAttribPointer(posID, 2, GL_FLOAT, GL_FALSE, 0, vertexData));
         GL_CALL(glEnableVertexAttribArray(posID));
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGL::disable(GL_BLEND);
 
         render_iteration(fb[0], fb[1], width, height);
 
         /* Reset gl state */
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        OpenGL::enable(GL_BLEND);
+        OpenGL::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-        GL_CALL(glUseProgram(0));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        OpenGL::use_program(0);
+        OpenGL::bind_texture(GL_TEXTURE_2D, 0);
         GL_CALL(glDisableVertexAttribArray(posID));
         OpenGL::render_end();
 
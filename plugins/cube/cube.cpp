@@ -30,6 +30,20 @@ class wayfire_cube : public wf::plugin_interface_t
     activator_callback rotate_left, rotate_right;
     wf::render_hook_t renderer;
 
+    /* Runs while the cube moves, and exits it when the exit animation ends */
+    wf::frame_callback_t update_animation = [=] (uint32_t frame_time)
+    {
+        animation.duration.set_frame_time(frame_time);
+        update_view_matrix();
+        output->render->damage_whole();
+        if (animation.duration.running())
+            return true;
+
+        if (animation.in_exit)
+            deactivate();
+        return false;
+    };
+
     /* Used to restore the pointer where the grab started */
     wf_point saved_pointer_position;
 
@@ -95,8 +109,7 @@ class wayfire_cube : public wf::plugin_interface_t
 
         zoom_opt = section->get_option("zoom", "0");
 
-        animation.duration = wf_duration(section->get_option("initial_animation", "350"));
-        animation.duration.start();
+        animation.duration = wf::frame_duration_t(section->get_option("initial_animation", "350"));
 
         background_mode = section->get_option("background_mode", "simple");
         reload_background();
@@ -199,7 +212,7 @@ class wayfire_cube : public wf::plugin_interface_t
         }
 
         GL_CALL(glLinkProgram(program.id));
-        GL_CALL(glUseProgram(program.id));
+        OpenGL::use_program(program.id);
 
         GL_CALL(glDeleteShader(vss));
         GL_CALL(glDeleteShader(fss));
@@ -242,7 +255,6 @@ class wayfire_cube : public wf::plugin_interface_t
             return false;
 
         output->render->set_renderer(renderer);
-        output->render->set_redraw_always(true);
         grab_interface->grab();
         return true;
     }
@@ -257,7 +269,7 @@ class wayfire_cube : public wf::plugin_interface_t
     void deactivate()
     {
         output->render->set_renderer(nullptr);
-        output->render->set_redraw_always(false);
+        output->render->rem_animation(&update_animation);
 
         grab_interface->ungrab();
         output->deactivate_plugin(grab_interface);
@@ -306,9 +318,7 @@ class wayfire_cube : public wf::plugin_interface_t
         animation.rotation = {animation.duration.progress(animation.rotation),
             animation.rotation.end - dir * animation.side_angle};
 
-        animation.duration.start();
-        update_view_matrix();
-        output->render->schedule_redraw();
+        start_animation();
     }
 
     /* Initiate with an button grab. */
@@ -338,10 +348,7 @@ class wayfire_cube : public wf::plugin_interface_t
         animation.zoom = {current_zoom, current_zoom};
         animation.ease_deformation = {animation.duration.progress(animation.ease_deformation), 1};
 
-        animation.duration.start();
-
-        update_view_matrix();
-        output->render->schedule_redraw();
+        start_animation();
     }
 
     /* Mouse grab was released */
@@ -360,10 +367,15 @@ class wayfire_cube : public wf::plugin_interface_t
         /* And reset other attributes, again to align the workspace with the output */
         reset_attribs();
 
-        animation.duration.start();
+        start_animation();
+    }
 
+    /* Start animating towards the current targets from the next frame */
+    void start_animation()
+    {
+        animation.duration.start(output->render->get_frame_time());
         update_view_matrix();
-        output->render->schedule_redraw();
+        output->render->add_animation(&update_animation);
     }
 
     /* Update the view matrix used in the next frame */
@@ -432,7 +444,7 @@ class wayfire_cube : public wf::plugin_interface_t
         for(size_t i = 0; i < streams.size(); i++)
         {
             int index = (vx + i) % streams.size();
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, streams[index].buffer.tex));
+            OpenGL::bind_texture(GL_TEXTURE_2D, streams[index].buffer.tex);
 
             auto model = calculate_model_matrix(i, fb_transform);
             GL_CALL(glUniformMatrix4fv(program.modelID, 1, GL_FALSE, &model[0][0]));
@@ -474,8 +486,8 @@ class wayfire_cube : public wf::plugin_interface_t
         auto vp = calculate_vp_matrix(dest);
 
         OpenGL::render_begin(dest);
-        GL_CALL(glUseProgram(program.id));
-        GL_CALL(glEnable(GL_DEPTH_TEST));
+        OpenGL::use_program(program.id);
+        OpenGL::enable(GL_DEPTH_TEST);
         GL_CALL(glDepthFunc(GL_LESS));
 
         static GLfloat vertexData[] = {
@@ -511,23 +523,17 @@ class wayfire_cube : public wf::plugin_interface_t
          * By using two stages, we ensure that we first render the cube sides
          * that are on the back, and then we render those at the front, so we
          * don't have to use depth testing and we also can support alpha cube. */
-        GL_CALL(glEnable(GL_CULL_FACE));
+        OpenGL::enable(GL_CULL_FACE);
         render_cube(GL_CCW, dest.transform);
         render_cube(GL_CW, dest.transform);
-        GL_CALL(glDisable(GL_CULL_FACE));
+        OpenGL::disable(GL_CULL_FACE);
 
-        GL_CALL(glDisable(GL_DEPTH_TEST));
-        GL_CALL(glUseProgram(0));
+        OpenGL::disable(GL_DEPTH_TEST);
+        OpenGL::use_program(0);
         GL_CALL(glDisableVertexAttribArray(program.posID));
         GL_CALL(glDisableVertexAttribArray(program.uvID));
         OpenGL::render_end();
 
-        update_view_matrix();
-        if (animation.duration.running())
-            output->render->schedule_redraw();
-
-        if (animation.in_exit && !animation.duration.running())
-            deactivate();
     }
 
     void pointer_moved(wlr_event_pointer_motion* ev)
@@ -554,8 +560,7 @@ class wayfire_cube : public wf::plugin_interface_t
         animation.ease_deformation = {animation.duration.progress(animation.ease_deformation),
             animation.ease_deformation.end};
 
-        animation.duration.start();
-        output->render->schedule_redraw();
+        start_animation();
     }
 
     void pointer_scrolled(double amount)
@@ -575,8 +580,7 @@ class wayfire_cube : public wf::plugin_interface_t
         target_zoom = std::min(std::max(target_zoom, ZOOM_MIN), ZOOM_MAX);
         animation.zoom = {start_zoom, target_zoom};
 
-        animation.duration.start();
-        output->render->schedule_redraw();
+        start_animation();
     }
 
     void fini()
@@ -3,13 +3,14 @@
 
 #include <config.h>
 #include <animation.hpp>
+#include <frame-duration.hpp>
 #include <opengl.hpp>
 
 #define TEX_ERROR_FLAG_COLOR  0, 1, 0, 1
 
 struct wf_cube_animation_attribs
 {
-    wf_duration duration;
+    wf::frame_duration_t duration;
 
     glm::mat4 projection, view;
     float side_angle;
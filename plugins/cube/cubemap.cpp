@@ -19,6 +19,11 @@ wf_cube_background_cubemap::~wf_cube_background_cubemap()
 {
     OpenGL::render_begin();
     GL_CALL(glDeleteProgram(program));
+    if (tex != (uint32_t)-1)
+    {
+        GL_CALL(glDeleteTextures(1, &tex));
+    }
+
     OpenGL::render_end();
 }
 
@@ -41,38 +46,51 @@ void wf_cube_background_cubemap::reload_texture()
     if (last_background_image == background_image->as_string())
         return;
 
+    /* The current texture is kept until the new image has been decoded */
     last_background_image = background_image->as_string();
+    texture_load.start(last_background_image,
+        [=] (std::shared_ptr<const image_io::image_t> image)
+        {
+            upload_texture(image);
+        });
+}
 
+void wf_cube_background_cubemap::upload_texture(
+    std::shared_ptr<const image_io::image_t> image)
+{
     OpenGL::render_begin();
-    if (tex == (uint32_t)-1)
+    if (!image)
     {
-        GL_CALL(glGenTextures(1, &tex));
-    }
+        log_error("Failed to load cubemap background image from \"%s\".",
+            last_background_image.c_str());
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    for (int i = 0; i < 6; i++)
-    {
-        if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i))
+        if (tex != (uint32_t)-1)
         {
-            log_error("Failed to load cubemap background image from \"%s\".",
-                last_background_image.c_str());
-
             GL_CALL(glDeleteTextures(1, &tex));
-            tex = -1;
-            break;
         }
+
+        tex = -1;
+        OpenGL::render_end();
+        return;
     }
 
-    if (tex != (uint32_t)-1)
+    if (tex == (uint32_t)-1)
     {
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+        GL_CALL(glGenTextures(1, &tex));
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
+    /* The same decoded image is used for all faces */
+    OpenGL::bind_texture(GL_TEXTURE_CUBE_MAP, tex);
+    for (int i = 0; i < 6; i++)
+        image_io::upload_to_texture(*image, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+
+    OpenGL::tex_parameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    OpenGL::tex_parameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    OpenGL::tex_parameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    OpenGL::tex_parameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    OpenGL::tex_parameter(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    OpenGL::bind_texture(GL_TEXTURE_CUBE_MAP, 0);
     OpenGL::render_end();
 }
 
@@ -86,15 +104,24 @@ void wf_cube_background_cubemap::render_frame(const wf_framebuffer& fb,
     OpenGL::render_begin(fb);
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        /* Still decoding the first image */
+        if (texture_load.is_pending())
+        {
+            GL_CALL(glClearColor(0, 0, 0, 1));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+        OpenGL::render_end();
         return;
     }
 
-    GL_CALL(glUseProgram(program));
+    OpenGL::use_program(program);
     GL_CALL(glDepthMask(GL_FALSE));
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
+    OpenGL::bind_texture(GL_TEXTURE_CUBE_MAP, tex);
 
     GL_CALL(glEnableVertexAttribArray(posID));
     GL_CALL(glVertexAttribPointer(posID, 3, GL_FLOAT, GL_FALSE, 0, skyboxVertices));
@@ -2,6 +2,7 @@
 #define WF_CUBE_CUBEMAP_HPP
 
 #include "cube-background.hpp"
+#include <img.hpp>
 
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
@@ -14,12 +15,14 @@ class wf_cube_background_cubemap : public wf_cube_background_base
 
     private:
     void reload_texture();
+    void upload_texture(std::shared_ptr<const image_io::image_t> image);
     void create_program();
 
     GLuint program = -1, tex = -1;
     GLuint matrixID, posID;
 
     std::string last_background_image;
+    image_io::async_load_t texture_load;
     wf_option background_image;
 };
 
@@ -27,6 +27,11 @@ wf_cube_background_skydome::~wf_cube_background_skydome()
 {
     OpenGL::render_begin();
     GL_CALL(glDeleteProgram(program));
+    if (tex != (uint32_t)-1)
+    {
+        GL_CALL(glDeleteTextures(1, &tex));
+    }
+
     OpenGL::render_end();
 }
 
@@ -52,32 +57,47 @@ void wf_cube_background_skydome::reload_texture()
     if (last_background_image == background_image->as_string())
         return;
 
+    /* The current texture is kept until the new image has been decoded */
     last_background_image = background_image->as_string();
+    texture_load.start(last_background_image,
+        [=] (std::shared_ptr<const image_io::image_t> image)
+        {
+            upload_texture(image);
+        });
+}
+
+void wf_cube_background_skydome::upload_texture(
+    std::shared_ptr<const image_io::image_t> image)
+{
     OpenGL::render_begin();
 
-    if (tex == (uint32_t)-1)
+    if (!image)
     {
-        GL_CALL(glGenTextures(1, &tex));
-    }
+        log_error("Failed to load skydome image from \"%s\".",
+            last_background_image.c_str());
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+        if (tex != (uint32_t)-1)
+        {
+            GL_CALL(glDeleteTextures(1, &tex));
+        }
 
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
-    {
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        tex = -1;
+        OpenGL::render_end();
+        return;
     }
-    else
+
+    if (tex == (uint32_t)-1)
     {
-        log_error("Failed to load skydome image from \"%s\".",
-            last_background_image.c_str());
-        GL_CALL(glDeleteTextures(1, &tex));
-        tex = -1;
+        GL_CALL(glGenTextures(1, &tex));
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    OpenGL::bind_texture(GL_TEXTURE_2D, tex);
+    image_io::upload_to_texture(*image, GL_TEXTURE_2D);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    OpenGL::bind_texture(GL_TEXTURE_2D, 0);
 
     OpenGL::render_end();
 }
@@ -144,14 +164,22 @@ void wf_cube_background_skydome::render_frame(const wf_framebuffer& fb,
 
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        /* Still decoding the first image */
+        if (texture_load.is_pending())
+        {
+            GL_CALL(glClearColor(0, 0, 0, 1));
+        } else
+        {
+            GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
+        }
+
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
         return;
     }
 
     OpenGL::render_begin(fb);
 
-    GL_CALL(glUseProgram(program));
+    OpenGL::use_program(program);
 
     GL_CALL(glEnableVertexAttribArray(posID));
     GL_CALL(glEnableVertexAttribArray(uvID));
@@ -180,8 +208,8 @@ void wf_cube_background_skydome::render_frame(const wf_framebuffer& fb,
 
     GL_CALL(glUniformMatrix4fv(modelID, 1, GL_FALSE, &model[0][0]));
 
-    GL_CALL(glActiveTexture(GL_TEXTURE0));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+    OpenGL::active_texture(GL_TEXTURE0);
+    OpenGL::bind_texture(GL_TEXTURE_2D, tex);
 
     GL_CALL(glDrawElements(GL_TRIANGLES,
             6 * SKYDOME_GRID_WIDTH * (SKYDOME_GRID_HEIGHT - 2),
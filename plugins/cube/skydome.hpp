@@ -3,6 +3,7 @@
 
 #include "cube-background.hpp"
 #include "output.hpp"
+#include <img.hpp>
 #include <vector>
 
 class wf_cube_background_skydome : public wf_cube_background_base
@@ -20,6 +21,7 @@ class wf_cube_background_skydome : public wf_cube_background_base
     void load_program();
     void fill_vertices();
     void reload_texture();
+    void upload_texture(std::shared_ptr<const image_io::image_t> image);
 
     GLuint program = -1, tex = -1;
     GLuint posID, uvID, modelID, vpID;
@@ -29,6 +31,7 @@ class wf_cube_background_skydome : public wf_cube_background_base
     std::vector<GLuint> indices;
 
     std::string last_background_image;
+    image_io::async_load_t texture_load;
     int last_mirror = -1;
 
     wf_option background_image, mirror_opt;
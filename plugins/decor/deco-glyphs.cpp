@@ -0,0 +1,484 @@
+#include "deco-glyphs.hpp"
+
+#include <cmath>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <core.hpp>
+#include <debug.hpp>
+
+#include <cairo.h>
+
+static const char* glyph_vertex_shader =
+R"(
+#version 100
+
+attribute mediump vec2 corner;
+attribute highp vec4 quad;
+attribute highp vec4 uv;
+
+uniform mat4 MVP;
+
+varying highp vec2 uvpos;
+
+void main() {
+    gl_Position = MVP * vec4(mix(quad.xy, quad.zw, corner), 0.0, 1.0);
+    uvpos = mix(uv.xy, uv.zw, corner);
+}
+)";
+
+static const char* glyph_fragment_shader =
+R"(
+#version 100
+precision mediump float;
+
+uniform sampler2D atlas;
+uniform vec4 color;
+
+varying highp vec2 uvpos;
+
+void main()
+{
+    gl_FragColor = texture2D(atlas, uvpos) * color;
+}
+)";
+
+static const int atlas_size = 1024;
+/* Empty space around each glyph, avoids bleeding when filtering */
+static const int glyph_padding = 1;
+
+namespace wf
+{
+namespace decor
+{
+bool glyph_key_t::operator < (const glyph_key_t& other) const
+{
+    if (pixel_size != other.pixel_size)
+        return pixel_size < other.pixel_size;
+    if (font != other.font)
+        return font < other.font;
+
+    return character < other.character;
+}
+
+std::shared_ptr<glyph_atlas_t> glyph_atlas_t::get()
+{
+    static std::weak_ptr<glyph_atlas_t> instance;
+
+    auto atlas = instance.lock();
+    if (!atlas)
+    {
+        atlas = std::shared_ptr<glyph_atlas_t> (new glyph_atlas_t());
+        instance = atlas;
+    }
+
+    return atlas;
+}
+
+glyph_atlas_t::glyph_atlas_t()
+{
+    OpenGL::render_begin();
+    program = OpenGL::create_program_from_source(
+        glyph_vertex_shader, glyph_fragment_shader);
+
+    corner_attrib = GL_CALL(glGetAttribLocation(program, "corner"));
+    quad_attrib   = GL_CALL(glGetAttribLocation(program, "quad"));
+    uv_attrib     = GL_CALL(glGetAttribLocation(program, "uv"));
+    mvp_id        = GL_CALL(glGetUniformLocation(program, "MVP"));
+    color_id      = GL_CALL(glGetUniformLocation(program, "color"));
+
+    GL_CALL(glGenTextures(1, &tex));
+    OpenGL::bind_texture(GL_TEXTURE_2D, tex);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas_size, atlas_size,
+            0, GL_RGBA, GL_UNSIGNED_BYTE, NULL));
+    OpenGL::bind_texture(GL_TEXTURE_2D, 0);
+    OpenGL::render_end();
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    wake_source = wl_event_loop_add_fd(wf::get_core().ev_loop, wake_fd,
+        WL_EVENT_READABLE, handle_glyphs_ready, this);
+
+    worker = std::thread([=] () { worker_main(); });
+}
+
+glyph_atlas_t::~glyph_atlas_t()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+    }
+
+    has_work.notify_one();
+    worker.join();
+
+    wl_event_source_remove(wake_source);
+    close(wake_fd);
+
+    OpenGL::render_begin();
+    GL_CALL(glDeleteTextures(1, &tex));
+    GL_CALL(glDeleteProgram(program));
+    OpenGL::render_end();
+}
+
+const glyph_t* glyph_atlas_t::lookup(const glyph_key_t& key)
+{
+    auto it = glyphs.find(key);
+    if (it != glyphs.end())
+        return it->second.pending ? nullptr : &it->second;
+
+    /* Not seen before, mark as pending and queue for rasterization */
+    glyphs[key] = glyph_t{};
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        requested.push_back(key);
+    }
+
+    has_work.notify_one();
+    return nullptr;
+}
+
+glyph_atlas_t::rasterized_glyph_t glyph_atlas_t::rasterize(
+    const glyph_key_t& key)
+{
+    rasterized_glyph_t result;
+    result.key = key;
+
+    /* Measure the glyph first, so we know how big its bitmap should be */
+    auto measure_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+    auto cr = cairo_create(measure_surface);
+    cairo_select_font_face(cr, key.font.c_str(), CAIRO_FONT_SLANT_NORMAL,
+        CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, key.pixel_size);
+
+    cairo_text_extents_t ext;
+    cairo_text_extents(cr, key.character.c_str(), &ext);
+    cairo_destroy(cr);
+    cairo_surface_destroy(measure_surface);
+
+    auto& metrics = result.metrics;
+    metrics.pending = false;
+    metrics.advance = ext.x_advance;
+    metrics.bearing_x = std::floor(ext.x_bearing) - glyph_padding;
+    metrics.bearing_y = std::floor(ext.y_bearing) - glyph_padding;
+
+    /* Whitespace, nothing to draw */
+    if (ext.width <= 0 || ext.height <= 0)
+    {
+        result.stride = 0;
+        return result;
+    }
+
+    metrics.width = std::ceil(ext.width) + 1 + 2 * glyph_padding;
+    metrics.height = std::ceil(ext.height) + 1 + 2 * glyph_padding;
+
+    auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+        metrics.width, metrics.height);
+    cr = cairo_create(surface);
+    cairo_select_font_face(cr, key.font.c_str(), CAIRO_FONT_SLANT_NORMAL,
+        CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size(cr, key.pixel_size);
+    cairo_set_source_rgba(cr, 1, 1, 1, 1);
+
+    cairo_move_to(cr, -metrics.bearing_x, -metrics.bearing_y);
+    cairo_show_text(cr, key.character.c_str());
+    cairo_destroy(cr);
+
+    cairo_surface_flush(surface);
+    result.stride = cairo_image_surface_get_stride(surface);
+
+    auto data = cairo_image_surface_get_data(surface);
+    result.pixels.assign(data, data + result.stride * metrics.height);
+    cairo_surface_destroy(surface);
+
+    return result;
+}
+
+void glyph_atlas_t::worker_main()
+{
+    while (true)
+    {
+        glyph_key_t key;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            has_work.wait(guard, [=] () { return quit || !requested.empty(); });
+            if (quit)
+                return;
+
+            key = requested.front();
+            requested.pop_front();
+        }
+
+        auto glyph = rasterize(key);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished.push_back(std::move(glyph));
+        }
+
+        uint64_t one = 1;
+        write(wake_fd, &one, sizeof(one));
+    }
+}
+
+int glyph_atlas_t::handle_glyphs_ready(int fd, uint32_t mask, void *data)
+{
+    uint64_t count;
+    read(fd, &count, sizeof(count));
+
+    auto atlas = static_cast<glyph_atlas_t*> (data);
+    atlas->upload_finished();
+    return 0;
+}
+
+void glyph_atlas_t::upload_finished()
+{
+    std::vector<rasterized_glyph_t> ready;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::swap(ready, finished);
+    }
+
+    if (ready.empty())
+        return;
+
+    OpenGL::render_begin();
+    OpenGL::bind_texture(GL_TEXTURE_2D, tex);
+    for (auto& glyph : ready)
+        upload(glyph);
+
+    GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+    OpenGL::bind_texture(GL_TEXTURE_2D, 0);
+    OpenGL::render_end();
+
+    emit_signal("glyphs-ready", nullptr);
+}
+
+void glyph_atlas_t::reset_atlas()
+{
+    /* Drop every uploaded glyph. Glyphs which are still being rasterized stay
+     * pending and will be uploaded into the new atlas when they arrive */
+    for (auto it = glyphs.begin(); it != glyphs.end();)
+    {
+        if (it->second.pending)
+            ++it;
+        else
+            it = glyphs.erase(it);
+    }
+
+    shelf_x = shelf_y = shelf_height = 0;
+    ++generation;
+}
+
+void glyph_atlas_t::upload(rasterized_glyph_t& glyph)
+{
+    auto& metrics = glyph.metrics;
+    if (metrics.width > atlas_size || metrics.height > atlas_size)
+    {
+        log_error("glyph too big for the title atlas: %dx%d",
+            metrics.width, metrics.height);
+        metrics.width = metrics.height = 0;
+    }
+
+    if (metrics.width > 0)
+    {
+        /* Start a new shelf if the glyph doesn't fit in the current one */
+        if (shelf_x + metrics.width > atlas_size)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_height + glyph_padding;
+            shelf_height = 0;
+        }
+
+        if (shelf_y + metrics.height > atlas_size)
+            reset_atlas();
+
+        GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, glyph.stride / 4));
+        GL_CALL(glTexSubImage2D(GL_TEXTURE_2D, 0, shelf_x, shelf_y,
+                metrics.width, metrics.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                glyph.pixels.data()));
+
+        metrics.uv.x1 = 1.0f * shelf_x / atlas_size;
+        metrics.uv.y1 = 1.0f * shelf_y / atlas_size;
+        metrics.uv.x2 = 1.0f * (shelf_x + metrics.width) / atlas_size;
+        metrics.uv.y2 = 1.0f * (shelf_y + metrics.height) / atlas_size;
+
+        shelf_x += metrics.width + glyph_padding;
+        shelf_height = std::max(shelf_height, metrics.height);
+    }
+
+    glyphs[glyph.key] = metrics;
+}
+
+void glyph_atlas_t::render_quads(const float *quads, const float *uvs,
+    int count, glm::mat4 projection, glm::vec4 color)
+{
+    static const GLfloat corners[] = {
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+        0.0f, 1.0f,
+        1.0f, 1.0f,
+    };
+
+    OpenGL::use_program(program);
+    OpenGL::active_texture(GL_TEXTURE0);
+    OpenGL::bind_texture(GL_TEXTURE_2D, tex);
+
+    GL_CALL(glVertexAttribPointer(corner_attrib, 2, GL_FLOAT, GL_FALSE, 0, corners));
+    GL_CALL(glEnableVertexAttribArray(corner_attrib));
+
+    GL_CALL(glVertexAttribPointer(quad_attrib, 4, GL_FLOAT, GL_FALSE, 0, quads));
+    GL_CALL(glEnableVertexAttribArray(quad_attrib));
+    GL_CALL(glVertexAttribDivisor(quad_attrib, 1));
+
+    GL_CALL(glVertexAttribPointer(uv_attrib, 4, GL_FLOAT, GL_FALSE, 0, uvs));
+    GL_CALL(glEnableVertexAttribArray(uv_attrib));
+    GL_CALL(glVertexAttribDivisor(uv_attrib, 1));
+
+    GL_CALL(glUniformMatrix4fv(mvp_id, 1, GL_FALSE, &projection[0][0]));
+    GL_CALL(glUniform4fv(color_id, 1, &color[0]));
+
+    OpenGL::enable(GL_BLEND);
+    OpenGL::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count));
+
+    /* Divisors are part of the vertex array state, reset them so that other
+     * users of these attribute indices aren't affected */
+    GL_CALL(glVertexAttribDivisor(quad_attrib, 0));
+    GL_CALL(glVertexAttribDivisor(uv_attrib, 0));
+    GL_CALL(glDisableVertexAttribArray(uv_attrib));
+    GL_CALL(glDisableVertexAttribArray(quad_attrib));
+    GL_CALL(glDisableVertexAttribArray(corner_attrib));
+    OpenGL::use_program(0);
+}
+
+/* Split the UTF-8 string into separate characters */
+static std::vector<std::string> split_characters(const std::string& text)
+{
+    std::vector<std::string> result;
+    for (char c : text)
+    {
+        /* Continuation bytes have the form 10xxxxxx */
+        if (result.empty() || (c & 0xC0) != 0x80)
+            result.emplace_back();
+
+        result.back() += c;
+    }
+
+    return result;
+}
+
+title_layout_t::title_layout_t(std::function<void()> on_ready)
+{
+    this->on_ready = on_ready;
+    this->atlas = glyph_atlas_t::get();
+    this->generation = atlas->get_generation();
+
+    on_glyphs_ready = [=] (wf::signal_data_t*)
+    {
+        if (complete && generation == atlas->get_generation())
+            return;
+
+        if (relayout())
+            this->on_ready();
+    };
+    atlas->connect_signal("glyphs-ready", &on_glyphs_ready);
+}
+
+title_layout_t::~title_layout_t()
+{
+    atlas->disconnect_signal("glyphs-ready", &on_glyphs_ready);
+}
+
+void title_layout_t::set_text(const std::string& text,
+    const std::string& font, int pixel_size)
+{
+    if (text == this->text && font == this->font &&
+        pixel_size == this->pixel_size)
+    {
+        return;
+    }
+
+    this->text = text;
+    this->font = font;
+    this->pixel_size = pixel_size;
+    this->complete = false;
+    relayout();
+}
+
+bool title_layout_t::relayout()
+{
+    std::vector<float> new_quads, new_uvs;
+
+    bool all_ready = true;
+    float pen = 0;
+    for (auto& character : split_characters(text))
+    {
+        auto glyph = atlas->lookup({font, pixel_size, character});
+        if (!glyph)
+        {
+            /* Keep requesting the rest, so they are rasterized in one go */
+            all_ready = false;
+            continue;
+        }
+
+        if (glyph->width > 0)
+        {
+            float x = pen + glyph->bearing_x;
+            float y = glyph->bearing_y;
+            new_quads.insert(new_quads.end(),
+                {x, y, x + glyph->width, y + glyph->height});
+            new_uvs.insert(new_uvs.end(),
+                {glyph->uv.x1, glyph->uv.y1, glyph->uv.x2, glyph->uv.y2});
+        }
+
+        pen += glyph->advance;
+    }
+
+    /* Keep showing the old title until the new one is complete, unless the
+     * old one points to glyphs which are no longer in the atlas */
+    if (all_ready || generation != atlas->get_generation())
+    {
+        quads = std::move(new_quads);
+        uvs = std::move(new_uvs);
+        generation = atlas->get_generation();
+    }
+
+    complete = all_ready;
+    return all_ready;
+}
+
+void title_layout_t::render(const wf_framebuffer& fb, int x, int baseline,
+    int max_width, float scale)
+{
+    if (generation != atlas->get_generation())
+        relayout();
+
+    /* Convert the glyph quads from pixels to the fb geometry coordinates,
+     * dropping the glyphs which don't fit */
+    std::vector<float> positioned;
+    positioned.reserve(quads.size());
+
+    int count = 0;
+    for (size_t i = 0; i < quads.size(); i += 4)
+    {
+        if (quads[i + 2] / scale > max_width)
+            break;
+
+        positioned.push_back(x + quads[i] / scale);
+        positioned.push_back(baseline + quads[i + 1] / scale);
+        positioned.push_back(x + quads[i + 2] / scale);
+        positioned.push_back(baseline + quads[i + 3] / scale);
+        ++count;
+    }
+
+    if (count == 0)
+        return;
+
+    atlas->render_quads(positioned.data(), uvs.data(), count,
+        fb.get_orthographic_projection(), glm::vec4(1.0));
+}
+}
+}
@@ -0,0 +1,183 @@
+#ifndef DECO_GLYPHS_HPP
+#define DECO_GLYPHS_HPP
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+#include <object.hpp>
+#include <opengl.hpp>
+
+struct wl_event_source;
+
+namespace wf
+{
+namespace decor
+{
+/**
+ * Identifies a single rasterized glyph: a character (as an UTF-8 sequence)
+ * rendered with a given cairo font at a given pixel size.
+ */
+struct glyph_key_t
+{
+    std::string font;
+    int pixel_size;
+    std::string character;
+
+    bool operator < (const glyph_key_t& other) const;
+};
+
+/**
+ * A glyph inside the atlas. All metrics are in pixels.
+ */
+struct glyph_t
+{
+    /* Glyph is still being rasterized */
+    bool pending = true;
+
+    /* Texture coordinates of the glyph in the atlas */
+    gl_geometry uv;
+
+    int width = 0, height = 0;
+    /* Offset of the glyph bitmap from the pen position on the baseline */
+    float bearing_x = 0, bearing_y = 0;
+    float advance = 0;
+};
+
+/**
+ * A single atlas texture with all glyphs used in titles, shared between all
+ * decorated views on all outputs.
+ *
+ * Glyphs are rasterized with cairo on a worker thread. Once they are ready,
+ * they are uploaded to the atlas on the main thread and the "glyphs-ready"
+ * signal is emitted, so that titles waiting for them can be laid out.
+ */
+class glyph_atlas_t : public wf::signal_provider_t
+{
+  public:
+    /** @return The shared atlas, created if it doesn't exist yet */
+    static std::shared_ptr<glyph_atlas_t> get();
+    ~glyph_atlas_t();
+
+    /**
+     * Find the given glyph in the atlas. If the glyph hasn't been requested
+     * before, it is queued for rasterization.
+     *
+     * @return The glyph, or nullptr if it isn't available yet.
+     */
+    const glyph_t* lookup(const glyph_key_t& key);
+
+    /** @return The atlas texture */
+    GLuint get_texture() const { return tex; }
+
+    /**
+     * The atlas is reset when it gets full. Glyph coordinates obtained
+     * from an older generation must not be used anymore.
+     */
+    uint32_t get_generation() const { return generation; }
+
+    /**
+     * Draw instanced glyph quads. Must be called between
+     * OpenGL::render_begin() and OpenGL::render_end().
+     *
+     * @param quads 4 floats per glyph: x1, y1, x2, y2
+     * @param uvs 4 floats per glyph: texture coordinates of x1, y1, x2, y2
+     * @param count The number of glyphs
+     */
+    void render_quads(const float *quads, const float *uvs, int count,
+        glm::mat4 projection, glm::vec4 color);
+
+  private:
+    glyph_atlas_t();
+
+    struct rasterized_glyph_t
+    {
+        glyph_key_t key;
+        glyph_t metrics;
+        int stride;
+        std::vector<uint8_t> pixels;
+    };
+
+    static rasterized_glyph_t rasterize(const glyph_key_t& key);
+    void worker_main();
+    void upload_finished();
+    void upload(rasterized_glyph_t& glyph);
+    void reset_atlas();
+
+    static int handle_glyphs_ready(int fd, uint32_t mask, void *data);
+
+    GLuint tex, program;
+    GLuint corner_attrib, quad_attrib, uv_attrib, mvp_id, color_id;
+    uint32_t generation = 0;
+
+    /* Shelf packing state */
+    int shelf_x = 0, shelf_y = 0, shelf_height = 0;
+
+    std::map<glyph_key_t, glyph_t> glyphs;
+
+    /* Shared with the worker thread */
+    std::mutex lock;
+    std::condition_variable has_work;
+    std::deque<glyph_key_t> requested;
+    std::vector<rasterized_glyph_t> finished;
+    bool quit = false;
+
+    int wake_fd;
+    wl_event_source *wake_source;
+    std::thread worker;
+};
+
+/**
+ * A title laid out as a list of glyph quads from the shared atlas.
+ */
+class title_layout_t
+{
+  public:
+    /** @param on_ready Called when a title which was waiting for glyphs has
+     *  been laid out, typically used to damage the decoration */
+    title_layout_t(std::function<void()> on_ready);
+    ~title_layout_t();
+
+    /** Set the text to lay out. No-op if nothing changed. */
+    void set_text(const std::string& text, const std::string& font,
+        int pixel_size);
+
+    /**
+     * Render the title. Must be called between OpenGL::render_begin() and
+     * OpenGL::render_end().
+     *
+     * @param x The x coordinate of the title start, in fb geometry coordinates
+     * @param baseline The y coordinate of the baseline
+     * @param max_width Glyphs past max_width aren't drawn
+     * @param scale The scale of the framebuffer
+     */
+    void render(const wf_framebuffer& fb, int x, int baseline,
+        int max_width, float scale);
+
+  private:
+    std::shared_ptr<glyph_atlas_t> atlas;
+    std::function<void()> on_ready;
+    wf::signal_callback_t on_glyphs_ready;
+
+    std::string text, font;
+    int pixel_size = 0;
+
+    bool complete = false;
+    uint32_t generation;
+
+    /* Laid out relative to the pen start, in pixels */
+    std::vector<float> quads, uvs;
+
+    /** @return true if all glyphs were available */
+    bool relayout();
+};
+}
+}
+
+#endif /* end of include guard: DECO_GLYPHS_HPP */
@@ -12,8 +12,7 @@
 #include <view-transform.hpp>
 #include <signal-definitions.hpp>
 #include "deco-subsurface.hpp"
-
-#include <cairo.h>
+#include "deco-glyphs.hpp"
 
 extern "C"
 {
@@ -28,49 +27,6 @@ const int titlebar_thickness = 30;
 const int resize_edge_threshold = 5;
 const int normal_thickness = resize_edge_threshold;
 
-GLuint get_text_texture(int width, int height,
-    std::string text, std::string cairo_font)
-{
-    const auto format = CAIRO_FORMAT_ARGB32;
-    auto surface = cairo_image_surface_create(format, width, height);
-    auto cr = cairo_create(surface);
-
-    const float font_scale = 0.8;
-    const float font_size = height * font_scale;
-
-    // render text
-    cairo_select_font_face(cr, cairo_font.c_str(), CAIRO_FONT_SLANT_NORMAL,
-        CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_source_rgba(cr, 1, 1, 1, 1);
-
-    cairo_set_font_size(cr, font_size);
-
-    cairo_text_extents_t ext;
-    cairo_text_extents(cr, text.c_str(), &ext);
-
-    cairo_move_to(cr, normal_thickness, font_size);
-    cairo_show_text(cr, text.c_str());
-
-    cairo_destroy(cr);
-
-    auto src = cairo_image_surface_get_data(surface);
-
-    GLuint tex;
-    GL_CALL(glGenTextures(1, &tex));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
-            GL_RGBA, GL_UNSIGNED_BYTE, src));
-
-    cairo_surface_destroy(surface);
-
-    return tex;
-}
-
 class simple_decoration_surface : public wf::surface_interface_t,
     public wf::compositor_surface_t, public wf_decorator_frame_t
 {
@@ -88,19 +44,19 @@ class simple_decoration_surface : public wf::surface_interface_t,
     float border_color[4] = {0.15f, 0.15f, 0.15f, 0.8f};
     float border_color_inactive[4] = {0.25f, 0.25f, 0.25f, 0.95f};
 
-    GLuint tex = -1;
-
+    wf::decor::title_layout_t title;
 
   public:
     simple_decoration_surface(wayfire_view view, wf_option font)
-        : surface_interface_t(view.get())
+        : surface_interface_t(view.get()), title([=] () { view->damage(); })
     {
         this->font_option = font;
         this->view = view;
         title_set = [=] (wf::signal_data_t *data)
         {
+            /* The new title is laid out on the next repaint */
             if (get_signaled_view(data) == view)
-                notify_view_resized(view->get_wm_geometry());
+                view->damage();
         };
         view->connect_signal("title-changed", &title_set);
     }
@@ -150,24 +106,21 @@ class simple_decoration_surface : public wf::surface_interface_t,
 
         wlr_render_quad_with_matrix(wf::get_core().renderer,
             active ? border_color : border_color_inactive, matrix);
+        OpenGL::invalidate_state();
 
-        if (tex == (uint)-1)
+        const float font_scale = 0.8;
+        if (titlebar == 0)
         {
-            tex = get_text_texture(width * fb.scale, titlebar * fb.scale,
-                view->get_title(), font_option->as_string());
+            OpenGL::render_end();
+            return;
         }
 
-        gl_geometry gg;
-        gg.x1 = x + fb.geometry.x;
-        gg.y1 = y + fb.geometry.y;
-        gg.x2 = gg.x1 + width;
-        gg.y2 = gg.y1 + titlebar;
+        title.set_text(view->get_title(), font_option->as_string(),
+            titlebar * fb.scale * font_scale);
+        title.render(fb, x + fb.geometry.x + normal_thickness,
+            y + fb.geometry.y + titlebar * font_scale,
+            width - 2 * normal_thickness, fb.scale);
 
-        OpenGL::render_transformed_texture(tex, gg, {},
-            fb.get_orthographic_projection(), {1, 1, 1, 1},
-            TEXTURE_TRANSFORM_INVERT_Y);
-
-        GL_CALL(glUseProgram(0));
         OpenGL::render_end();
     }
 
@@ -318,13 +271,6 @@ class simple_decoration_surface : public wf::surface_interface_t,
     {
         view->damage();
 
-        if (tex != (uint32_t)-1)
-        {
-            GL_CALL(glDeleteTextures(1, &tex));
-        }
-
-        tex = -1;
-
         width = view_geometry.width;
         height = view_geometry.height;
         update_frame_region();
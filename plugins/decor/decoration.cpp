@@ -6,9 +6,14 @@
 #include <signal-definitions.hpp>
 
 #include "deco-subsurface.hpp"
+#include "deco-glyphs.hpp"
+
 class wayfire_decoration : public wf::plugin_interface_t
 {
     wf_option font;
+    /* Keep the title atlas alive while the plugin is loaded, even if there
+     * are no decorated views at the moment */
+    std::shared_ptr<wf::decor::glyph_atlas_t> atlas;
     wf::signal_callback_t view_created;
 
     public:
@@ -18,6 +23,7 @@ class wayfire_decoration : public wf::plugin_interface_t
         grab_interface->capabilities = wf::CAPABILITY_VIEW_DECORATOR;
 
         font = config->get_section("decoration")->get_option("font", "serif");
+        atlas = wf::decor::glyph_atlas_t::get();
 
         view_created = [=] (wf::signal_data_t *data)
         {
@@ -48,6 +54,7 @@ class wayfire_decoration : public wf::plugin_interface_t
             view->set_decoration(nullptr);
 
         output->disconnect_signal("map-view", &view_created);
+        atlas.reset();
     }
 };
 
@@ -0,0 +1,95 @@
+#include <plugin.hpp>
+#include <output.hpp>
+#include <debug.hpp>
+#include <frame-capture.hpp>
+#include <ctime>
+#include <memory>
+
+/* Saves screenshots of the output, either on demand or periodically.
+ * The image is read back without stalling the compositor and encoded on
+ * a worker thread. */
+class wayfire_capture : public wf::plugin_interface_t
+{
+    activator_callback capture_cb;
+    wf_option binding, interval, directory, damage_only;
+
+    std::unique_ptr<wf::frame_capture_t> capture;
+    wf::wl_timer timer;
+    int capture_count = 0;
+
+    public:
+        void init(wayfire_config *config)
+        {
+            grab_interface->name = "capture";
+            grab_interface->abilities_mask = 0;
+
+            auto section = config->get_section("capture");
+            binding     = section->get_option("binding", "KEY_SYSRQ");
+            interval    = section->get_option("interval", "0");
+            directory   = section->get_option("directory", "/tmp");
+            damage_only = section->get_option("damage_only", "1");
+
+            capture = std::make_unique<wf::frame_capture_t> (output);
+
+            capture_cb = [=] (wf_activator_source, uint32_t) {
+                take_screenshot();
+            };
+            output->add_activator(binding, &capture_cb);
+
+            interval->add_updated_handler(&interval_changed);
+            interval_changed();
+        }
+
+        wf_option_callback interval_changed = [=] ()
+        {
+            timer.disconnect();
+            if (interval->as_int() > 0)
+                schedule_periodic();
+        };
+
+        void schedule_periodic()
+        {
+            timer.set_timeout(interval->as_int(), [=] () {
+                take_screenshot();
+                schedule_periodic();
+            });
+        }
+
+        std::string get_file_name()
+        {
+            char timestamp[64];
+            auto now = std::time(NULL);
+            std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S",
+                std::localtime(&now));
+
+            return directory->as_string() + "/wayfire-" +
+                output->handle->name + "-" + timestamp + "-" +
+                std::to_string(capture_count++) + ".png";
+        }
+
+        void take_screenshot()
+        {
+            /* Encoding can't keep up, skip this capture instead of
+             * queueing up frames */
+            if (image_io::get_pending_writes() > 0)
+            {
+                log_info("capture: dropping frame, encoder is busy");
+                return;
+            }
+
+            auto name = get_file_name();
+            capture->capture([=] (std::shared_ptr<const image_io::image_t> frame) {
+                image_io::write_to_file_async(name, frame, "png");
+            }, damage_only->as_int());
+        }
+
+        void fini()
+        {
+            output->rem_binding(&capture_cb);
+            interval->rem_updated_handler(&interval_changed);
+            timer.disconnect();
+            capture.reset();
+        }
+};
+
+DECLARE_WAYFIRE_PLUGIN(wayfire_capture);
@@ -9,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <animation.hpp>
+#include <frame-duration.hpp>
 
 /* TODO: this file should be included in some header maybe(plugin.hpp) */
 #include <linux/input-event-codes.h>
@@ -33,10 +34,23 @@ class wayfire_expo : public wf::plugin_interface_t
     wf_option background_color, zoom_animation_duration;
     wf_option delimiter_offset;
 
-    wf_duration zoom_animation;
+    wf::frame_duration_t zoom_animation;
 
     wf::render_hook_t renderer;
 
+    /* The workspace streams are updated on every frame while expo is
+     * active, because views on other workspaces don't damage the output */
+    wf::frame_callback_t update_animation = [=] (uint32_t frame_time)
+    {
+        zoom_animation.set_frame_time(frame_time);
+        update_zoom();
+        if (!state.active)
+            return false;
+
+        output->render->damage_whole();
+        return true;
+    };
+
     struct {
         bool active = false;
         bool moving = false;
@@ -70,7 +84,7 @@ class wayfire_expo : public wf::plugin_interface_t
         }
 
         zoom_animation_duration = section->get_option("duration", "300");
-        zoom_animation = wf_duration(zoom_animation_duration);
+        zoom_animation = wf::frame_duration_t(zoom_animation_duration);
 
         delimiter_offset = section->get_option("offset", "10");
 
@@ -129,7 +143,7 @@ class wayfire_expo : public wf::plugin_interface_t
         state.active = true;
         state.button_pressed = false;
         state.moving = false;
-        zoom_animation.start();
+        zoom_animation.start(output->render->get_frame_time());
 
         GetTuple(vx, vy, output->workspace->get_current_workspace());
 
@@ -138,7 +152,7 @@ class wayfire_expo : public wf::plugin_interface_t
         calculate_zoom(true);
 
         output->render->set_renderer(renderer);
-        output->render->set_redraw_always();
+        output->render->add_animation(&update_animation);
     }
 
     void deactivate()
@@ -146,7 +160,7 @@ class wayfire_expo : public wf::plugin_interface_t
         if (state.moving)
             end_move();
 
-        zoom_animation.start();
+        zoom_animation.start(output->render->get_frame_time());
         state.moving = false;
 
         output->workspace->set_workspace(std::make_tuple(target_vx, target_vy));
@@ -402,10 +416,8 @@ class wayfire_expo : public wf::plugin_interface_t
             }
         }
 
-        GL_CALL(glUseProgram(0));
+        OpenGL::use_program(0);
         OpenGL::render_end();
-
-        update_zoom();
     }
 
     struct {
@@ -453,7 +465,7 @@ class wayfire_expo : public wf::plugin_interface_t
         }
 
         state.zoom_in = zoom_in;
-        zoom_animation.start();
+        zoom_animation.start(output->render->get_frame_time());
     }
 
     void update_zoom()
@@ -485,7 +497,7 @@ class wayfire_expo : public wf::plugin_interface_t
         }
 
         output->render->set_renderer(nullptr);
-        output->render->set_redraw_always(false);
+        output->render->rem_animation(&update_animation);
     }
 
     void fini()
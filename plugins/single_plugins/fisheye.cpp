@@ -186,9 +186,9 @@ class wayfire_fisheye : public wf::plugin_interface_t
 
             OpenGL::render_begin(dest);
 
-            GL_CALL(glUseProgram(program));
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, source.tex));
-            GL_CALL(glActiveTexture(GL_TEXTURE0));
+            OpenGL::use_program(program);
+            OpenGL::bind_texture(GL_TEXTURE_2D, source.tex);
+            OpenGL::active_texture(GL_TEXTURE0);
 
             GL_CALL(glUniform2f(mouseID, x, y));
             GL_CALL(glUniform2f(resID, dest.viewport_width, dest.viewport_height));
@@ -200,7 +200,7 @@ class wayfire_fisheye : public wf::plugin_interface_t
 
             GL_CALL(glDrawArrays (GL_TRIANGLE_FAN, 0, 4));
             GL_CALL(glDisableVertexAttribArray(posID));
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+            OpenGL::bind_texture(GL_TEXTURE_2D, 0);
 
             OpenGL::render_end();
 
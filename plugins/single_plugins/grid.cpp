@@ -2,13 +2,16 @@
 #include <output.hpp>
 #include <core.hpp>
 #include <view.hpp>
+#include <view-transform.hpp>
 #include <workspace-manager.hpp>
 #include <render-manager.hpp>
+#include <transaction.hpp>
 #include <algorithm>
 #include <cmath>
 #include <linux/input-event-codes.h>
 #include "signal-definitions.hpp"
 #include <animation.hpp>
+#include <frame-duration.hpp>
 
 #include "snap_signal.hpp"
 #include "../wobbly/wobbly-signal.hpp"
@@ -20,14 +23,132 @@ extern "C"
 
 const std::string grid_view_id = "grid-view";
 
+/**
+ * Shows a view which is being resized to a new geometry without waiting for
+ * the client to redraw at every intermediate size.
+ *
+ * The view's contents before the resize are saved, and both the old contents
+ * and the current view buffer are scaled to the interpolated geometry, with
+ * the old contents fading out on top.
+ */
+class grid_crossfade_transformer : public wf_view_transformer_t
+{
+    wayfire_view view;
+    wf_framebuffer original_buffer;
+    wf_geometry original_wm;
+
+  public:
+    static const std::string name;
+
+    /* The wm geometry the view should appear to have */
+    wf_geometry displayed;
+    /* The alpha of the old contents */
+    float overlay_alpha = 1.0;
+
+    grid_crossfade_transformer(wayfire_view view)
+    {
+        this->view = view;
+        original_wm = displayed = view->get_wm_geometry();
+        view->render_snapshot(original_buffer);
+    }
+
+    ~grid_crossfade_transformer()
+    {
+        OpenGL::render_begin();
+        original_buffer.release();
+        OpenGL::render_end();
+    }
+
+    uint32_t get_z_order() override { return WF_TRANSFORMER_2D - 1; }
+
+    /* Map a box from a view with the given wm geometry to the displayed
+     * geometry */
+    wlr_box scale_box(wf_geometry wm, wlr_box box)
+    {
+        double sx = 1.0 * displayed.width / std::max(wm.width, 1);
+        double sy = 1.0 * displayed.height / std::max(wm.height, 1);
+
+        wlr_box result;
+        result.x = std::floor(displayed.x + (box.x - wm.x) * sx);
+        result.y = std::floor(displayed.y + (box.y - wm.y) * sy);
+        result.width = std::ceil(box.width * sx);
+        result.height = std::ceil(box.height * sy);
+        return result;
+    }
+
+    wf_point local_to_transformed_point(wf_geometry, wf_point point) override
+    {
+        auto box = scale_box(view->get_wm_geometry(), {point.x, point.y, 0, 0});
+        return {box.x, box.y};
+    }
+
+    wf_point transformed_to_local_point(wf_geometry, wf_point point) override
+    {
+        auto wm = view->get_wm_geometry();
+        double sx = 1.0 * std::max(wm.width, 1) / std::max(displayed.width, 1);
+        double sy = 1.0 * std::max(wm.height, 1) / std::max(displayed.height, 1);
+
+        return {
+            int(std::floor(wm.x + (point.x - displayed.x) * sx)),
+            int(std::floor(wm.y + (point.y - displayed.y) * sy)),
+        };
+    }
+
+    wlr_box get_bounding_box(wf_geometry, wlr_box region) override
+    {
+        auto current = scale_box(view->get_wm_geometry(), region);
+        if (overlay_alpha <= 0)
+            return current;
+
+        auto original = scale_box(original_wm, original_buffer.geometry);
+        int x1 = std::min(current.x, original.x);
+        int y1 = std::min(current.y, original.y);
+        int x2 = std::max(current.x + current.width,
+            original.x + original.width);
+        int y2 = std::max(current.y + current.height,
+            original.y + original.height);
+
+        return {x1, y1, x2 - x1, y2 - y1};
+    }
+
+    void render_box(uint32_t src_tex, wlr_box src_box,
+        wlr_box scissor_box, const wf_framebuffer& target_fb) override
+    {
+        auto to_gl = [] (wlr_box box) -> gl_geometry {
+            return {1.0f * box.x, 1.0f * box.y,
+                1.0f * (box.x + box.width), 1.0f * (box.y + box.height)};
+        };
+
+        OpenGL::render_begin(target_fb);
+        target_fb.scissor(scissor_box);
+
+        auto ortho = target_fb.get_orthographic_projection();
+        OpenGL::render_transformed_texture(src_tex,
+            to_gl(scale_box(view->get_wm_geometry(), src_box)), {}, ortho);
+
+        if (overlay_alpha > 0)
+        {
+            OpenGL::render_transformed_texture(original_buffer.tex,
+                to_gl(scale_box(original_wm, original_buffer.geometry)), {},
+                ortho, {1.0f, 1.0f, 1.0f, overlay_alpha});
+        }
+
+        OpenGL::render_end();
+    }
+};
+const std::string grid_crossfade_transformer::name = "grid-crossfade";
+
+/* How long to wait for the client to resize after the crossfade animation */
+static constexpr uint32_t CROSSFADE_COMMIT_TIMEOUT = 500;
+
 class wayfire_grid_view_cdata : public wf::custom_data_t
 {
-    wf_duration duration;
+    wf::frame_duration_t duration;
     bool is_active = true;
 
     wayfire_view view;
     wf::output_t *output;
-    wf::effect_hook_t pre_hook;
+    wf::frame_callback_t animation_hook;
     wf::signal_callback_t unmapped;
 
     uint32_t tiled_edges;
@@ -35,6 +156,11 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
     const wf::plugin_grab_interface_uptr& iface;
     wf_option animation_type;
 
+    /* Whether the crossfade animation is used */
+    bool crossfade = false;
+    /* When to stop waiting for the client to resize, 0 if not waiting */
+    uint32_t commit_deadline = 0;
+
     public:
 
     wayfire_grid_view_cdata(wayfire_view view,
@@ -45,7 +171,7 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
         this->view = view;
         this->output = view->get_output();
         this->animation_type = animation_type;
-        duration = wf_duration(animation_duration);
+        duration = wf::frame_duration_t(animation_duration);
 
         if (!view->get_output()->activate_plugin(iface))
         {
@@ -53,10 +179,10 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
             return;
         }
 
-        pre_hook = [=] () {
-            adjust_geometry();
+        animation_hook = [=] (uint32_t frame_time) {
+            return adjust_geometry(frame_time);
         };
-        output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+        output->render->add_animation(&animation_hook);
 
         unmapped = [=] (wf::signal_data_t *data)
         {
@@ -64,7 +190,6 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
                 destroy();
         };
 
-        output->render->set_redraw_always(true);
         output->connect_signal("view-disappeared", &unmapped);
         output->connect_signal("detach-view", &unmapped);
     }
@@ -84,9 +209,12 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
         if (view->get_transformer("wobbly") || !is_active)
             type = "wobbly";
 
+        if (type != "crossfade")
+            stop_crossfade();
+
         if (type == "none")
         {
-            set_end_state(geometry, tiled_edges);
+            snap_immediately(geometry, tiled_edges);
             return destroy();
         }
 
@@ -104,10 +232,94 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
             return destroy();
         }
 
+        if (type == "crossfade")
+        {
+            start_crossfade();
+            set_end_state(geometry, tiled_edges);
+            return;
+        }
+
         view->set_maximized(1);
         view->set_moving(1);
         view->set_resizing(1);
-        duration.start();
+        duration.start(output->render->get_frame_time());
+    }
+
+    grid_crossfade_transformer *get_crossfade()
+    {
+        return dynamic_cast<grid_crossfade_transformer*> (
+            view->get_transformer(grid_crossfade_transformer::name).get());
+    }
+
+    /**
+     * Start the crossfade animation. The client is configured only once, with
+     * the final size, and gets the whole animation to redraw.
+     */
+    void start_crossfade()
+    {
+        auto tr = get_crossfade();
+        if (tr)
+        {
+            /* Continue from where the running animation is */
+            initial = tr->displayed;
+        } else
+        {
+            view->add_transformer(
+                std::make_unique<grid_crossfade_transformer> (view),
+                grid_crossfade_transformer::name);
+        }
+
+        crossfade = true;
+        commit_deadline = 0;
+        duration.start(output->render->get_frame_time());
+    }
+
+    void stop_crossfade()
+    {
+        if (crossfade)
+            view->pop_transformer(grid_crossfade_transformer::name);
+        crossfade = false;
+    }
+
+    /** @return false when the crossfade has finished */
+    bool adjust_crossfade(uint32_t frame_time)
+    {
+        auto tr = get_crossfade();
+        if (!tr)
+        {
+            destroy();
+            return false;
+        }
+
+        view->damage();
+        if (duration.running())
+        {
+            tr->displayed = {
+                (int)duration.progress(initial.x, target.x),
+                (int)duration.progress(initial.y, target.y),
+                (int)duration.progress(initial.width, target.width),
+                (int)duration.progress(initial.height, target.height),
+            };
+            tr->overlay_alpha = duration.progress(1.0, 0.0);
+            view->damage();
+            return true;
+        }
+
+        tr->displayed = target;
+        tr->overlay_alpha = 0;
+        view->damage();
+
+        /* Keep scaling the view until the client has resized */
+        auto wm = view->get_wm_geometry();
+        bool resized = wm.width == target.width && wm.height == target.height;
+        if (!commit_deadline)
+            commit_deadline = frame_time + CROSSFADE_COMMIT_TIMEOUT;
+
+        if (!resized && frame_time < commit_deadline)
+            return true;
+
+        destroy();
+        return false;
     }
 
     void set_end_state(wf_geometry geometry, uint32_t edges)
@@ -124,15 +336,36 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
         view->set_tiled(edges);
     }
 
-    void adjust_geometry()
+    /**
+     * Set the end state in a transaction, so that the view keeps showing
+     * its old contents until the client has resized, and then the new
+     * geometry and maximized state appear in a single frame.
+     */
+    void snap_immediately(wf_geometry geometry, uint32_t edges)
+    {
+        wf::transaction_t transaction;
+        transaction.set_maximized(view, __builtin_popcount(edges) == 4);
+        transaction.set_geometry(view, geometry);
+        transaction.commit();
+
+        view->set_tiled(edges);
+    }
+
+    /** @return false when the animation has finished */
+    bool adjust_geometry(uint32_t frame_time)
     {
+        duration.set_frame_time(frame_time);
+        if (crossfade)
+            return adjust_crossfade(frame_time);
+
         if (!duration.running())
         {
             set_end_state(target, tiled_edges);
             view->set_moving(0);
             view->set_resizing(0);
 
-            return destroy();
+            destroy();
+            return false;
         }
 
         int cx = duration.progress(initial.x, target.x);
@@ -141,6 +374,7 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
         int ch = duration.progress(initial.height, target.height);
 
         view->set_geometry({cx, cy, cw, ch});
+        return true;
     }
 
     ~wayfire_grid_view_cdata()
@@ -148,9 +382,9 @@ class wayfire_grid_view_cdata : public wf::custom_data_t
         if (!is_active)
             return;
 
-        output->render->rem_effect(&pre_hook);
+        stop_crossfade();
+        output->render->rem_animation(&animation_hook);
         output->deactivate_plugin(iface);
-        output->render->set_redraw_always(false);
         output->disconnect_signal("view-disappeared", &unmapped);
         output->disconnect_signal("detach-view", &unmapped);
     }
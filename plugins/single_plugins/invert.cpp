@@ -102,9 +102,9 @@ class wayfire_invert_screen : public wf::plugin_interface_t
 
         OpenGL::render_begin(destination);
 
-        GL_CALL(glUseProgram(program));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, source.tex));
-        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        OpenGL::use_program(program);
+        OpenGL::bind_texture(GL_TEXTURE_2D, source.tex);
+        OpenGL::active_texture(GL_TEXTURE0);
 
         GL_CALL(glVertexAttribPointer(posID, 2, GL_FLOAT, GL_FALSE, 0, vertexData));
         GL_CALL(glEnableVertexAttribArray(posID));
@@ -112,15 +112,15 @@ class wayfire_invert_screen : public wf::plugin_interface_t
         GL_CALL(glVertexAttribPointer(uvID, 2, GL_FLOAT, GL_FALSE, 0, coordData));
         GL_CALL(glEnableVertexAttribArray(uvID));
 
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGL::disable(GL_BLEND);
         GL_CALL(glDrawArrays (GL_TRIANGLE_FAN, 0, 4));
 
-        GL_CALL(glEnable(GL_BLEND));
+        OpenGL::enable(GL_BLEND);
 
         GL_CALL(glDisableVertexAttribArray(posID));
         GL_CALL(glDisableVertexAttribArray(uvID));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-        GL_CALL(glUseProgram(0));
+        OpenGL::bind_texture(GL_TEXTURE_2D, 0);
+        OpenGL::use_program(0);
 
         OpenGL::render_end();
     }
@@ -0,0 +1,272 @@
+#include <plugin.hpp>
+#include <output.hpp>
+#include <debug.hpp>
+#include <frame-capture.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+/**
+ * Writes frames to a file on a separate thread.
+ *
+ * Frames are written at a constant rate: a frame is repeated until the next
+ * one was presented, and frames which come faster than the frame rate are
+ * skipped. Both formats can be read by ffmpeg and most video tools:
+ *
+ * - y4m: YUV4MPEG2 with 4:4:4 BT.601 YUV, so that no colors are lost to
+ *   subsampling.
+ * - raw: RGBA pixels, top row first, one frame after another.
+ */
+class frame_writer_t
+{
+  public:
+    frame_writer_t(FILE *file, bool y4m, int fps, int max_queued)
+    {
+        this->file = file;
+        this->y4m = y4m;
+        this->fps = fps;
+        this->max_queued = max_queued;
+        worker = std::thread([=] () { worker_main(); });
+    }
+
+    /** Finishes writing all queued frames and closes the file */
+    ~frame_writer_t()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            quit = true;
+        }
+
+        has_work.notify_one();
+        worker.join();
+        std::fclose(file);
+    }
+
+    /**
+     * Queue the frame for writing.
+     * @return false if the queue is full and the frame was dropped
+     */
+    bool push(std::shared_ptr<const image_io::image_t> frame, uint32_t time)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if ((int)queue.size() >= max_queued)
+                return false;
+
+            queue.push_back({frame, time});
+        }
+
+        has_work.notify_one();
+        return true;
+    }
+
+  private:
+    struct queued_frame_t
+    {
+        std::shared_ptr<const image_io::image_t> image;
+        uint32_t time;
+    };
+
+    FILE *file;
+    bool y4m;
+    int fps, max_queued;
+
+    /* Accessed only by the worker */
+    int width = -1, height = -1;
+    uint32_t start_time;
+    uint64_t frames_written = 0;
+    std::vector<uint8_t> buffer;
+
+    std::mutex lock;
+    std::condition_variable has_work;
+    std::deque<queued_frame_t> queue;
+    bool quit = false;
+    std::thread worker;
+
+    void worker_main()
+    {
+        while (true)
+        {
+            queued_frame_t frame;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                has_work.wait(guard, [=] () { return quit || !queue.empty(); });
+
+                if (queue.empty())
+                    return;
+
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            write_frame(frame);
+        }
+    }
+
+    void write_frame(const queued_frame_t& frame)
+    {
+        auto& image = *frame.image;
+        if (width < 0)
+        {
+            width = image.width;
+            height = image.height;
+            start_time = frame.time;
+
+            if (y4m)
+            {
+                std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+                    width, height, fps);
+            }
+        }
+
+        /* The stream has a fixed size */
+        if (image.width != width || image.height != height)
+        {
+            log_error("recorder: output size changed, dropping frame");
+            return;
+        }
+
+        uint64_t target = uint64_t(frame.time - start_time) * fps / 1000 + 1;
+        if (target <= frames_written)
+            return;
+
+        if (y4m)
+        {
+            convert_to_yuv(image);
+        } else
+        {
+            buffer.assign(image.pixels.begin(), image.pixels.end());
+        }
+
+        for (; frames_written < target; frames_written++)
+        {
+            if (y4m)
+                std::fputs("FRAME\n", file);
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+        }
+    }
+
+    /* Convert to planar 4:4:4 with limited range BT.601 coefficients */
+    void convert_to_yuv(const image_io::image_t& image)
+    {
+        size_t plane = size_t(width) * height;
+        buffer.resize(plane * 3);
+
+        uint8_t *y = buffer.data(), *u = y + plane, *v = u + plane;
+        const uint8_t *px = image.pixels.data();
+        for (size_t i = 0; i < plane; i++, px += 4)
+        {
+            int r = px[0], g = px[1], b = px[2];
+            y[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            u[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            v[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+};
+
+/* Records the output to a file. Frames are read back asynchronously, and
+ * dropped if the GPU or the writer fall behind, so that recording never
+ * stalls the compositor. With autostart, recording starts with the
+ * compositor, which is handy for capturing runs on the headless backend. */
+class wayfire_recorder : public wf::plugin_interface_t
+{
+    activator_callback toggle_cb;
+    wf_option toggle, directory, format, fps, queue_size, autostart;
+
+    std::unique_ptr<wf::frame_capture_t> capture;
+    std::unique_ptr<frame_writer_t> writer;
+    uint32_t writer_dropped = 0;
+
+    public:
+        void init(wayfire_config *config)
+        {
+            grab_interface->name = "recorder";
+            grab_interface->abilities_mask = 0;
+
+            auto section = config->get_section("recorder");
+            toggle     = section->get_option("toggle", "<super> <alt> KEY_R");
+            directory  = section->get_option("directory", "/tmp");
+            format     = section->get_option("format", "y4m");
+            fps        = section->get_option("fps", "60");
+            queue_size = section->get_option("queue_size", "4");
+            autostart  = section->get_option("autostart", "0");
+
+            toggle_cb = [=] (wf_activator_source, uint32_t) {
+                if (writer)
+                {
+                    stop_recording();
+                } else
+                {
+                    start_recording();
+                }
+            };
+            output->add_activator(toggle, &toggle_cb);
+
+            if (autostart->as_int())
+                start_recording();
+        }
+
+        std::string get_file_name(std::string extension)
+        {
+            char timestamp[64];
+            auto now = std::time(NULL);
+            std::strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S",
+                std::localtime(&now));
+
+            return directory->as_string() + "/wayfire-" +
+                output->handle->name + "-" + timestamp + "." + extension;
+        }
+
+        void start_recording()
+        {
+            bool y4m = format->as_string() != "raw";
+            auto name = get_file_name(y4m ? "y4m" : "rgba");
+
+            FILE *file = std::fopen(name.c_str(), "wb");
+            if (!file)
+            {
+                log_error("recorder: failed to open %s", name.c_str());
+                return;
+            }
+
+            log_info("recorder: recording %s to %s",
+                output->handle->name, name.c_str());
+
+            writer = std::make_unique<frame_writer_t> (file, y4m,
+                std::max(fps->as_int(), 1), std::max(queue_size->as_int(), 1));
+            writer_dropped = 0;
+
+            /* One buffer in the GPU, one ready to be mapped */
+            capture = std::make_unique<wf::frame_capture_t> (output, 2);
+            capture->start_stream([=] (
+                    std::shared_ptr<const image_io::image_t> frame, uint32_t time)
+            {
+                if (!writer->push(frame, time))
+                    ++writer_dropped;
+            });
+        }
+
+        void stop_recording()
+        {
+            if (!writer)
+                return;
+
+            log_info("recorder: stopped, dropped %u frames in readback, "
+                "%u in writer", capture->get_dropped_frames(), writer_dropped);
+
+            capture.reset();
+            writer.reset();
+        }
+
+        void fini()
+        {
+            output->rem_binding(&toggle_cb);
+            stop_recording();
+        }
+};
+
+DECLARE_WAYFIRE_PLUGIN(wayfire_recorder);
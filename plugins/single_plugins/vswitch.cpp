@@ -8,9 +8,11 @@
 #include <workspace-manager.hpp>
 
 #include <queue>
+#include <cmath>
 #include <linux/input.h>
 #include <utility>
 #include <animation.hpp>
+#include <frame-duration.hpp>
 #include <set>
 #include "view-change-viewport-signal.hpp"
 #include "../wobbly/wobbly-signal.hpp"
@@ -32,7 +34,7 @@ class vswitch : public wf::plugin_interface_t
 
         gesture_callback gesture_cb;
 
-        wf_duration duration;
+        wf::frame_duration_t duration;
         wf_transition dx, dy;
         wayfire_view grabbed_view = nullptr;
 
@@ -86,7 +88,7 @@ class vswitch : public wf::plugin_interface_t
         output->add_activator(binding_win_down,  &callback_win_down);
 
         animation_duration = section->get_option("duration", "180");
-        duration = wf_duration(animation_duration);
+        duration = wf::frame_duration_t(animation_duration);
 
         output->connect_signal("set-workspace-request", &on_set_workspace_request);
     }
@@ -120,7 +122,7 @@ class vswitch : public wf::plugin_interface_t
         dx = {duration.progress(dx), 1.0 * tvx - vx};
         dy = {duration.progress(dy), 1.0 * tvy - vy};
 
-        duration.start();
+        duration.start(output->render->get_frame_time());
     }
 
     wf::signal_callback_t on_set_workspace_request = [=] (wf::signal_data_t *data)
@@ -137,18 +139,6 @@ class vswitch : public wf::plugin_interface_t
         add_direction(vx - ox, vy - oy);
     };
 
-    std::vector<wayfire_view> get_ws_views()
-    {
-        std::vector<wayfire_view> views;
-        for (auto& view : output->workspace->get_views_in_layer(wf::MIDDLE_LAYERS))
-        {
-            if (view != grabbed_view)
-                views.push_back(view);
-        }
-
-        return views;
-    }
-
     void ensure_transformer(wayfire_view view)
     {
         if (!view->get_transformer(vswitch_view_transformer::name))
@@ -164,32 +154,45 @@ class vswitch : public wf::plugin_interface_t
         if (!output->activate_plugin(grab_interface))
             return false;
 
-        output->render->add_effect(&update_animation, wf::OUTPUT_EFFECT_PRE);
-        output->render->set_redraw_always();
+        output->render->add_animation(&update_animation);
 
-        duration.start();
+        duration.start(output->render->get_frame_time());
         dx = dy = {0, 0};
 
         return true;
     }
 
-    wf::effect_hook_t update_animation = [=] ()
+    wf::frame_callback_t update_animation = [=] (uint32_t frame_time)
     {
+        duration.set_frame_time(frame_time);
         if (!duration.running())
-            return stop_switch();
+        {
+            stop_switch();
+            return false;
+        }
 
         GetTuple(sw, sh, output->get_screen_size());
-        for (auto view : get_ws_views())
+        wf_point offset = {
+            (int)std::round(duration.progress(dx) * sw),
+            (int)std::round(duration.progress(dy) * sh),
+        };
+
+        /* The whole viewport is slid by the render manager, only the grabbed
+         * view needs to move along so that it stays in place */
+        output->render->set_viewport_offset(offset);
+        if (grabbed_view)
         {
-            ensure_transformer(view);
-            auto tr = dynamic_cast<vswitch_view_transformer*> (
-                view->get_transformer(vswitch_view_transformer::name).get());
-
-            view->damage();
-            tr->translation_x = -duration.progress(dx) * sw;
-            tr->translation_y = -duration.progress(dy) * sh;
-            view->damage();
+            ensure_transformer(grabbed_view);
+            auto tr = dynamic_cast<vswitch_view_transformer*> (grabbed_view->
+                get_transformer(vswitch_view_transformer::name).get());
+
+            grabbed_view->damage();
+            tr->translation_x = offset.x;
+            tr->translation_y = offset.y;
+            grabbed_view->damage();
         }
+
+        return true;
     };
 
     void slide_done()
@@ -223,14 +226,14 @@ class vswitch : public wf::plugin_interface_t
     void stop_switch()
     {
         slide_done();
-        grabbed_view = nullptr;
+        output->render->set_viewport_offset({0, 0});
 
-        for (auto view : get_ws_views())
-            view->pop_transformer(vswitch_view_transformer::name);
+        if (grabbed_view)
+            grabbed_view->pop_transformer(vswitch_view_transformer::name);
+        grabbed_view = nullptr;
 
         output->deactivate_plugin(grab_interface);
-        output->render->rem_effect(&update_animation);
-        output->render->set_redraw_always(false);
+        output->render->rem_animation(&update_animation);
     }
 
     void fini()
@@ -4,18 +4,20 @@
 #include <debug.hpp>
 #include <render-manager.hpp>
 #include <animation.hpp>
+#include <frame-duration.hpp>
 
 class wayfire_zoom_screen : public wf::plugin_interface_t
 {
 
     wf::post_hook_t hook;
+    wf::frame_callback_t update_animation;
     axis_callback axis;
 
     wf_option speed, modifier, smoothing_duration;
 
     float target_zoom = 1.0;
     bool hook_set = false;
-    wf_duration duration;
+    wf::frame_duration_t duration;
 
     public:
         void init(wayfire_config *config)
@@ -24,6 +26,20 @@ class wayfire_zoom_screen : public wf::plugin_interface_t
                 render(source, dest);
             };
 
+            /* The zoomed area follows the cursor, so the output is
+             * repainted on every frame while zoomed */
+            update_animation = [=] (uint32_t frame_time)
+            {
+                duration.set_frame_time(frame_time);
+                output->render->damage_whole();
+                if (duration.running() || duration.progress() - 1 > 0.01)
+                    return true;
+
+                output->render->rem_post(&hook);
+                hook_set = false;
+                return false;
+            };
+
             axis = [=] (wlr_event_pointer_axis* ev)
             {
                 if (ev->orientation == WLR_AXIS_ORIENTATION_VERTICAL)
@@ -37,8 +53,8 @@ class wayfire_zoom_screen : public wf::plugin_interface_t
             speed    = section->get_option("speed", "0.005");
             smoothing_duration = section->get_option("smoothing_duration", "300");
 
-            duration = wf_duration(smoothing_duration);
-            duration.start(1, 1); // so that the first value we get is correct
+            duration = wf::frame_duration_t(smoothing_duration);
+            duration.start(0, 1, 1); // so that the first value we get is correct
         }
 
         void update_zoom_target(float delta)
@@ -52,13 +68,14 @@ class wayfire_zoom_screen : public wf::plugin_interface_t
             if (last_target != target_zoom)
             {
                 auto current = duration.progress();
-                duration.start(current, target_zoom);
+                duration.start(output->render->get_frame_time(),
+                    current, target_zoom);
 
                 if (!hook_set)
                 {
                     hook_set = true;
                     output->render->add_post(&hook);
-                    output->render->set_redraw_always();
+                    output->render->add_animation(&update_animation);
                 }
             }
         }
@@ -89,24 +106,20 @@ class wayfire_zoom_screen : public wf::plugin_interface_t
             const float y1 = y * scale;
 
             OpenGL::render_begin(source);
-            GL_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, source.fb));
-            GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.fb));
+            OpenGL::bind_framebuffer(GL_READ_FRAMEBUFFER, source.fb);
+            OpenGL::bind_framebuffer(GL_DRAW_FRAMEBUFFER, destination.fb);
             GL_CALL(glBlitFramebuffer(x1, y1, x1 + tw, y1 + th, 0, 0, w, h,
                     GL_COLOR_BUFFER_BIT, GL_LINEAR));
             OpenGL::render_end();
-
-            if (!duration.running() && current_zoom - 1 <= 0.01)
-            {
-                output->render->set_redraw_always(false);
-                output->render->rem_post(&hook);
-                hook_set = false;
-            }
         }
 
         void fini()
         {
             if (hook_set)
+            {
                 output->render->rem_post(&hook);
+                output->render->rem_animation(&update_animation);
+            }
 
             output->rem_binding(&axis);
         }
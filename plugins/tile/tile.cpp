@@ -596,16 +596,16 @@ class wayfire_tile : public wayfire_plugin_t
             data[2] = color.b * 255; data[3] = color.a * 255;
 
             GL_CALL(glGenTextures(1, &colored_texture));
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, colored_texture));
+            OpenGL::bind_texture(GL_TEXTURE_2D, colored_texture);
             GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
             GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
             GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0));
             GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, 0));
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
             GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
                         1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, data));
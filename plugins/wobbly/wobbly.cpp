@@ -71,14 +71,14 @@ void main()
     /* Requires bound opengl context */
     void render_triangles(GLuint tex, glm::mat4 mat, float *pos, float *uv, int cnt)
     {
-        GL_CALL(glUseProgram(program));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        OpenGL::use_program(program);
+        OpenGL::active_texture(GL_TEXTURE0);
+        OpenGL::bind_texture(GL_TEXTURE_2D, tex);
 
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
         GL_CALL(glVertexAttribPointer(posID, 2, GL_FLOAT, GL_FALSE, 0, pos));
         GL_CALL(glEnableVertexAttribArray(posID));
@@ -87,11 +87,11 @@ void main()
         GL_CALL(glEnableVertexAttribArray(uvID));
 
         GL_CALL(glUniformMatrix4fv(mvpID, 1, GL_FALSE, &mat[0][0]));
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        OpenGL::enable(GL_BLEND);
+        OpenGL::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
         GL_CALL(glDrawArrays (GL_TRIANGLES, 0, 3 * cnt));
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGL::disable(GL_BLEND);
 
         GL_CALL(glDisableVertexAttribArray(uvID));
         GL_CALL(glDisableVertexAttribArray(posID));
@@ -141,6 +141,7 @@ class wf_wobbly : public wf_view_transformer_t
 
     wf_geometry snapped_geometry;
     uint32_t last_frame;
+    wf_point last_viewport_origin;
 
     public:
     wf_wobbly(wayfire_view view, const wf::plugin_grab_interface_uptr& _iface)
@@ -165,6 +166,7 @@ class wf_wobbly : public wf_view_transformer_t
         model->uv = NULL;
 
         last_frame = get_current_time();
+        last_viewport_origin = view->get_output()->workspace->get_viewport_origin();
         wobbly_init(model.get());
 
         pre_hook = [=] () {
@@ -192,6 +194,8 @@ class wf_wobbly : public wf_view_transformer_t
 
             sig->output->render->rem_effect(&pre_hook);
             view->get_output()->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+            last_viewport_origin =
+                view->get_output()->workspace->get_viewport_origin();
         };
 
         view->connect_signal("unmap", &view_removed);
@@ -220,8 +224,28 @@ class wf_wobbly : public wf_view_transformer_t
         return point;
     }
 
+    /* Views in the middle layers aren't moved when the workspace changes,
+     * but the model is in output-local coordinates */
+    void check_viewport_changed()
+    {
+        auto workspace = view->get_output()->workspace.get();
+        auto origin = workspace->get_viewport_origin();
+        if (origin == last_viewport_origin)
+            return;
+
+        if (!has_active_grab &&
+            (workspace->get_view_layer(view) & wf::MIDDLE_LAYERS))
+        {
+            translate(last_viewport_origin.x - origin.x,
+                last_viewport_origin.y - origin.y);
+        }
+
+        last_viewport_origin = origin;
+    }
+
     void update_model()
     {
+        check_viewport_changed();
         view->damage();
 
         auto bbox = view->get_bounding_box("wobbly");
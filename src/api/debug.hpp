@@ -5,24 +5,121 @@
 #include "config.h"
 #endif
 
+#include <atomic>
+#include <cstdarg>
+#include <string>
+
 extern "C"
 {
 #include  <wlr/util/log.h>
 }
 
 const char *wf_strip_path(const char *path);
-#define wf_log(verb, fmt, ...) \
-    _wlr_log(verb, "[%s:%d] " fmt, wf_strip_path(__FILE__), __LINE__, ##__VA_ARGS__)
 
-#define log_error(...) wf_log(WLR_ERROR, __VA_ARGS__)
-#define log_info(...)  wf_log(WLR_INFO,  __VA_ARGS__)
+/**
+ * Wayfire's logging.
+ *
+ * Each message belongs to a subsystem (for ex. "core", "cursor" or the name
+ * of a plugin), whose verbosity can be changed at runtime with the
+ * core/log_levels option. Messages above WF_LOG_MAX_VERBOSITY are removed at
+ * compile time, together with the evaluation of their arguments.
+ *
+ * Messages are formatted into a lock-free queue. The timestamp and prefix
+ * are added, and the messages are written out, on a separate thread, so
+ * logging doesn't block the compositor on write syscalls.
+ */
+namespace wf
+{
+namespace log
+{
+/** A named part of the compositor with its own verbosity */
+struct subsystem_t
+{
+    std::string name;
+    std::atomic<int> verbosity;
+};
+
+/**
+ * Find or create the subsystem with the given name. Subsystems are never
+ * freed, so the pointer can be cached.
+ */
+subsystem_t *get_subsystem(const char *name);
+
+/**
+ * Set the verbosity of all subsystems.
+ *
+ * @param verbosity The verbosity of subsystems without a filter.
+ * @param filters Space or comma separated list of subsystem:level pairs,
+ *        where level is one of silent, error, info or debug.
+ */
+void set_verbosity(wlr_log_importance verbosity,
+    const std::string& filters = "");
+
+/**
+ * Queue a message. If the logging thread isn't running, the message is
+ * written immediately.
+ */
+void write(wlr_log_importance verbosity, subsystem_t *subsystem,
+    const char *file, int line, const char *fmt, ...)
+    __attribute__((format(printf, 5, 6)));
+
+void write_va(wlr_log_importance verbosity, subsystem_t *subsystem,
+    const char *file, int line, const char *fmt, va_list args);
+
+/** Start the logging thread. Messages from wlroots are routed through it
+ * as well. */
+void start();
+
+/** Write out all queued messages and stop the logging thread, for ex. on
+ * shutdown or after a crash */
+void stop();
+}
+}
+
+#define WF_LOG_LEVEL_ERROR 1
+#define WF_LOG_LEVEL_INFO  2
+#define WF_LOG_LEVEL_DEBUG 3
 
+#ifndef WF_LOG_MAX_VERBOSITY
 #ifdef WAYFIRE_DEBUG_ENABLED
-#define log_debug(...) wf_log(WLR_DEBUG, __VA_ARGS__)
+#define WF_LOG_MAX_VERBOSITY WF_LOG_LEVEL_DEBUG
+#else
+#define WF_LOG_MAX_VERBOSITY WF_LOG_LEVEL_INFO
+#endif
+#endif
+
+/* The subsystem is looked up only once per call site */
+#define wf_log_in(verb, subsystem, ...) \
+    do { \
+        static wf::log::subsystem_t *_wf_log_subsystem = \
+            wf::log::get_subsystem(subsystem); \
+        if ((verb) <= _wf_log_subsystem->verbosity.load(std::memory_order_relaxed)) \
+        { \
+            wf::log::write(verb, _wf_log_subsystem, __FILE__, __LINE__, \
+                __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define log_error_in(subsystem, ...) wf_log_in(WLR_ERROR, subsystem, __VA_ARGS__)
+
+#if WF_LOG_MAX_VERBOSITY >= WF_LOG_LEVEL_INFO
+#define log_info_in(subsystem, ...) wf_log_in(WLR_INFO, subsystem, __VA_ARGS__)
+#else
+#define log_info_in(subsystem, ...)
+#endif
+
+#if WF_LOG_MAX_VERBOSITY >= WF_LOG_LEVEL_DEBUG
+#define log_debug_in(subsystem, ...) wf_log_in(WLR_DEBUG, subsystem, __VA_ARGS__)
 #else
-#define log_debug(...)
+#define log_debug_in(subsystem, ...)
 #endif
 
+#define wf_log(verb, ...) wf_log_in(verb, "core", __VA_ARGS__)
+
+#define log_error(...) log_error_in("core", __VA_ARGS__)
+#define log_info(...)  log_info_in("core", __VA_ARGS__)
+#define log_debug(...) log_debug_in("core", __VA_ARGS__)
+
 #define nonull(x) ((x) ? (x) : ("nil"))
 
 void wf_print_trace();
@@ -0,0 +1,79 @@
+#ifndef WF_FRAME_CAPTURE_HPP
+#define WF_FRAME_CAPTURE_HPP
+
+#include "output.hpp"
+#include "img.hpp"
+
+namespace wf
+{
+/**
+ * frame_capture_t reads back the output image without stalling the
+ * compositor.
+ *
+ * While a capture or a stream is pending, it installs a post hook on the
+ * output which passes the image through unchanged, and copies it to one of
+ * a ring of pixel buffer objects. The pixels are handed to the capture
+ * callback on a later frame, once the GPU has finished the copy. When
+ * nothing is pending, the output is rendered as if there was no capture.
+ *
+ * Captured frames are in the orientation of the output's framebuffer, i.e
+ * output transforms are not undone.
+ */
+class frame_capture_t : public noncopyable_t
+{
+  public:
+    /**
+     * Called on the main thread with the captured image, top row first.
+     * The image is shared with the capture and must not be modified.
+     */
+    using callback_t =
+        std::function<void(std::shared_ptr<const image_io::image_t> frame)>;
+
+    /**
+     * @param output The output to capture
+     * @param ring_size How many readbacks can be in flight at once
+     */
+    frame_capture_t(wf::output_t *output, int ring_size = 2);
+    ~frame_capture_t();
+
+    /**
+     * Capture the current image of the output.
+     *
+     * @param damage_only Read back only the parts of the output which have
+     *        been damaged since the last capture and reuse the rest from the
+     *        previous capture. Useful for periodic captures of mostly static
+     *        outputs.
+     */
+    void capture(callback_t callback, bool damage_only = false);
+
+    /**
+     * Called on the main thread with each frame of a stream.
+     *
+     * @param time The time the frame was presented, as in get_current_time()
+     */
+    using stream_callback_t = std::function<void(
+        std::shared_ptr<const image_io::image_t> frame, uint32_t time)>;
+
+    /**
+     * Capture every frame which is presented on the output until
+     * stop_stream() is called. Frames are read back damage-only.
+     *
+     * If all buffers are in use when a frame is presented, the frame is
+     * dropped instead of waiting for the GPU. Starting a stream stops the
+     * previous one.
+     */
+    void start_stream(stream_callback_t callback);
+
+    /** Stop the stream. Frames in flight are discarded. */
+    void stop_stream();
+
+    /** @return The number of frames dropped since the stream was started */
+    uint32_t get_dropped_frames() const;
+
+    class impl;
+  private:
+    std::unique_ptr<impl> pimpl;
+};
+}
+
+#endif /* end of include guard: WF_FRAME_CAPTURE_HPP */
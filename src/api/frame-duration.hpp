@@ -0,0 +1,61 @@
+#ifndef WF_FRAME_DURATION_HPP
+#define WF_FRAME_DURATION_HPP
+
+#include <animation.hpp>
+#include <cstdint>
+
+namespace wf
+{
+/**
+ * A wf_duration driven by the frame clock of an output, instead of the
+ * current time.
+ *
+ * Animations registered with render_manager::add_animation() should advance
+ * it with the frame time they get, so that each frame shows the state at
+ * its predicted presentation time, and all frames advance in steps of
+ * exactly one refresh cycle.
+ */
+class frame_duration_t
+{
+    wf_option duration;
+    std::function<double(double)> smooth_function;
+
+    uint32_t start_time = 0;
+    uint32_t frame_time = 0;
+    int32_t length = 0;
+    bool is_running = false;
+
+    wf_transition transition = {0, 0};
+
+  public:
+    frame_duration_t(wf_option duration = nullptr,
+        std::function<double(double)> smooth = wf_animation::circle);
+
+    /**
+     * Start the animation.
+     *
+     * @param frame_time The time of the first frame, usually
+     *        render_manager::get_frame_time()
+     */
+    void start(uint32_t frame_time);
+
+    /** Start the animation and set the transition used by progress() */
+    void start(uint32_t frame_time, double start, double end);
+
+    /** Advance the animation to the given frame time */
+    void set_frame_time(uint32_t frame_time);
+
+    /** @return The smoothed progress at the current frame, in [0, 1] */
+    double progress_percentage();
+
+    /** @return The value of the transition set with start() */
+    double progress();
+    double progress(double start, double end);
+    double progress(const wf_transition& transition);
+
+    /** @return Whether the current frame is before the end of the animation */
+    bool running();
+};
+}
+
+#endif /* end of include guard: WF_FRAME_DURATION_HPP */
@@ -4,17 +4,82 @@
 #include "debug.hpp"
 #include <GLES2/gl2.h>
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <nonstd/noncopyable.hpp>
 
 namespace image_io
 {
+    /* A decoded image. Rows are tightly packed, top row first */
+    struct image_t
+    {
+        int width = 0, height = 0;
+        /* GL_RGBA or GL_RGB */
+        GLenum format = GL_RGBA;
+        std::vector<uint8_t> pixels;
+    };
+
     /* Load the image from the given file, binding it to the given GL texture target
      * Bind the texture before you call this function
-     * Guaranteed: doesn't change any GL state except pixel packing */
+     * Guaranteed: doesn't change any GL state except pixel packing
+     *
+     * Decoding happens synchronously, so prefer async_load_t when the image
+     * is loaded while the compositor is running */
     bool load_from_file(std::string name, GLuint target);
 
+    /* Decode the image in the given file. Safe to call from any thread.
+     * Images are cached by their content, so decoding the same image again
+     * (even from a different path) is cheap.
+     *
+     * Returns nullptr if the image couldn't be decoded */
+    std::shared_ptr<const image_t> decode_file(std::string name);
+
+    /* Upload a decoded image to the given GL texture target.
+     * Same requirements and guarantees as load_from_file() */
+    void upload_to_texture(const image_t& image, GLuint target);
+
+    /**
+     * Decodes an image on a worker thread. The result is delivered on the
+     * main thread, where it can be uploaded with upload_to_texture().
+     *
+     * Destroying the request or starting a new one cancels the pending load,
+     * i.e its callback won't be called.
+     */
+    class async_load_t : public noncopyable_t
+    {
+      public:
+        /* image is nullptr if the image couldn't be decoded */
+        using callback_t =
+            std::function<void(std::shared_ptr<const image_t> image)>;
+
+        async_load_t() = default;
+        ~async_load_t();
+
+        /* Start loading the given file, cancelling any pending load */
+        void start(std::string name, callback_t callback);
+        /* Cancel the pending load, no-op if there is none */
+        void cancel();
+        /* @return true if the callback hasn't been called yet */
+        bool is_pending() const;
+
+        struct state_t;
+      private:
+        std::shared_ptr<state_t> state;
+    };
+
     /* Function that saves the given pixels(in rgba format) to a (currently) png file */
     void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type);
 
+    /* Same as write_to_file(), but the image is encoded and written on a
+     * worker thread. The image must not be modified afterwards */
+    void write_to_file_async(std::string name,
+        std::shared_ptr<const image_t> image, std::string type);
+
+    /* @return The number of image tasks waiting for a free worker, useful
+     * for throttling async writes */
+    size_t get_pending_writes();
+
     /* Initializes all backends, called at startup */
     void init();
 }
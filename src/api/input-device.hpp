@@ -6,6 +6,8 @@ extern "C"
 #include <wlr/types/wlr_input_device.h>
 }
 
+#include "util.hpp"
+
 namespace wf
 {
     class input_device_t
@@ -29,6 +31,12 @@ namespace wf
          */
         bool is_enabled();
 
+        /**
+         * @return The latencies from the device's events to the first frame
+         * which could show them
+         */
+        latency_histogram_t get_input_latency();
+
         protected:
         wlr_input_device *handle;
         input_device_t(wlr_input_device *handle);
@@ -2,6 +2,7 @@
 #define WF_OPENGL_HPP
 
 #include <GLES3/gl3.h>
+#include <vector>
 
 #include <config.hpp>
 #include <util.hpp>
@@ -144,6 +145,49 @@ namespace OpenGL
                                     glm::vec4 color = glm::vec4(1.f),
                                     uint32_t bits = 0);
 
+    /* Render a list of textured triangles with a single draw call.
+     * vertex_data has 4 floats per vertex: x, y in normalized device
+     * coordinates, followed by the u, v texture coordinates.
+     * The texture is a GL_TEXTURE_2D with premultiplied alpha. If has_alpha
+     * is false, the texture's alpha channel is ignored. */
+    void render_textured_triangles(GLuint tex,
+        const std::vector<GLfloat>& vertex_data, bool has_alpha = true);
+
+    /* Cached GL state.
+     *
+     * The functions below skip the GL call if the requested state is already
+     * current. The cache is reset in render_begin() and render_end(). Code
+     * which changes the same state in another way between them (wlroots
+     * rendering functions, deleting a bound texture, etc.) must call
+     * invalidate_state() afterwards. */
+    void use_program(GLuint program);
+    void active_texture(GLenum unit);
+    void bind_texture(GLenum target, GLuint tex);
+    void bind_framebuffer(GLenum target, GLuint fb);
+    /* Only GL_BLEND and GL_DEPTH_TEST are cached, others are passed through */
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+    void blend_func(GLenum sfactor, GLenum dfactor);
+    /* Set a parameter of the texture bound to target on the active unit */
+    void tex_parameter(GLenum target, GLenum pname, GLint value);
+    /* Forget the cached state, the next calls will all be issued */
+    void invalidate_state();
+
+    struct state_stats_t
+    {
+        /* Calls which were passed to GL */
+        uint32_t issued = 0;
+        /* Calls which were skipped because the state was already set */
+        uint32_t filtered = 0;
+    };
+
+    /* @return The number of state calls in the last repainted output frame.
+     *
+     * Since the cache is reset in every render_begin() and render_end(),
+     * the filtered calls are mostly the redundant ones within a single
+     * render_begin()/render_end() pair, not across them. */
+    state_stats_t get_state_stats();
+
     /* Reads the shader source from the given file and compiles it */
     GLuint load_shader(std::string path, GLuint type);
     /* Compiles the given shader source */
@@ -3,6 +3,7 @@
 
 #include "output.hpp"
 #include "object.hpp"
+#include "util.hpp"
 
 struct wf_framebuffer_base;
 struct wf_framebuffer;
@@ -22,6 +23,49 @@ using render_hook_t = std::function<void(const wf_framebuffer& fb)>;
  * at certain parts of the repaint cycle */
 using effect_hook_t = std::function<void()>;
 
+/**
+ * Frame callbacks are used to drive animations from the output's frame
+ * clock. They are called once per frame, before repainting the output.
+ *
+ * @param frame_time The predicted presentation time of the frame, in ms,
+ *        on the same clock as get_current_time().
+ *
+ * @return true if the animation continues, false if it has finished. A
+ *         finished animation is removed from the output.
+ */
+using frame_callback_t = std::function<bool(uint32_t frame_time)>;
+
+/**
+ * Statistics about the damage on an output, since the output was created.
+ * Rectangle counts are per repainted frame, before and after the damage
+ * was simplified.
+ */
+struct damage_stats_t
+{
+    uint64_t frames = 0;
+    uint64_t total_rects_in = 0;
+    uint64_t total_rects_out = 0;
+    int max_rects_in = 0;
+    int max_rects_out = 0;
+};
+
+/**
+ * Statistics of the frame scheduler of an output. Repaints are delayed
+ * until the predicted render time (plus a safety margin) before the next
+ * vblank.
+ */
+struct frame_schedule_stats_t
+{
+    /* Predicted duration of the next repaint, in milliseconds */
+    float predicted_render_time = 0;
+    /* How long the last repaint was delayed after the frame event, in ms */
+    float last_delay = 0;
+    /* Number of frames committed */
+    uint64_t frames = 0;
+    /* Number of frames which finished after the vblank they targeted */
+    uint64_t misses = 0;
+};
+
 enum output_effect_type_t
 {
     /* Pre hooks are called immediately before repainting the output */
@@ -90,6 +134,40 @@ class render_manager : public wf::signal_provider_t
      */
     void schedule_redraw();
 
+    /**
+     * Send frame done to the surfaces on the output at its next vblank,
+     * without repainting it. If the output is repainted in the meantime,
+     * frame done is sent with the repaint. Used for commits which didn't
+     * change anything on the screen, but whose clients still wait for frame
+     * callbacks.
+     */
+    void schedule_frame_done();
+
+    /**
+     * Register an animation with the output's frame clock. The output is
+     * repainted as long as at least one animation is running, so there is
+     * no need to use set_redraw_always() for animations. The callback should
+     * damage what it changes, and can use wf::frame_duration_t to advance
+     * with the frame time.
+     *
+     * @param callback The animation callback. It is called before each frame
+     *        until it returns false or is removed with rem_animation().
+     */
+    void add_animation(frame_callback_t *callback);
+
+    /**
+     * Remove an animation. No-op if the animation isn't running.
+     */
+    void rem_animation(frame_callback_t *callback);
+
+    /**
+     * @return The predicted presentation time of the next frame of the
+     * output, in ms, on the same clock as get_current_time(). Animations
+     * should use it instead of the current time, so that they advance in
+     * steps of exactly one refresh cycle.
+     */
+    uint32_t get_frame_time() const;
+
     /**
      * Inhibit rendering to the output. An inhibited output will show a
      * fully black image. Used mainly for compositor fade in/out on startup.
@@ -129,6 +207,22 @@ class render_manager : public wf::signal_provider_t
      */
     wf_region get_scheduled_damage();
 
+    /**
+     * @return Statistics about the number of damage rectangles per frame
+     */
+    damage_stats_t get_damage_stats() const;
+
+    /**
+     * @return Statistics about repaint timing on the output
+     */
+    frame_schedule_stats_t get_frame_schedule_stats() const;
+
+    /**
+     * @return The latencies from input events to the first frame of the
+     * output which could show them
+     */
+    latency_histogram_t get_input_latency() const;
+
     /**
      * Damage all workspaces of the output. Should not be used inside render
      * hooks, view transformers, etc.
@@ -169,6 +263,24 @@ class render_manager : public wf::signal_provider_t
      */
     wlr_box get_ws_box(std::tuple<int, int> ws) const;
 
+    /**
+     * Scroll the part of the workspace grid shown by the default renderer.
+     * The output then shows the rectangle at the given offset from the
+     * current workspace, which may span several workspaces, for ex. to slide
+     * between them. Views are rendered directly, without any transformers.
+     *
+     * While the offset is not zero, the whole output is repainted each frame.
+     * Pointer and touch input is mapped with the same offset, so it goes to
+     * the views where they are shown. Shell views aren't scrolled.
+     *
+     * @param offset The offset in output-local coordinates, {0, 0} to show
+     *        just the current workspace again.
+     */
+    void set_viewport_offset(wf_point offset);
+
+    /** @return The offset set by set_viewport_offset() */
+    wf_point get_viewport_offset() const;
+
     /**
      * @return The framebuffer on which all rendering operations except post
      * effects happen.
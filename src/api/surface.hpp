@@ -5,11 +5,13 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <type_traits>
 
 #include "geometry.hpp"
 
 struct wf_region;
 struct wf_framebuffer;
+struct wlr_presentation_event;
 namespace wf
 {
 class output_t;
@@ -82,6 +84,29 @@ class surface_interface_t
     virtual std::vector<surface_iterator_t> enumerate_surfaces(
         wf_point surface_origin = {0, 0});
 
+    /**
+     * Call the visitor for each mapped surface in the surface tree, in the
+     * same order as enumerate_surfaces(), but without building a list. Used
+     * on hot paths, for ex. once per view per frame.
+     *
+     * @param visitor A callable taking the surface and its position, i.e
+     *        void(surface_interface_t*, wf_point).
+     * @param surface_origin The coordinates of the top-left corner of the
+     *        surface.
+     * @param reverse Visit the surfaces from the bottom-most to the topmost.
+     */
+    template<class Visitor>
+    void for_each_surface(Visitor&& visitor, wf_point surface_origin = {0, 0},
+        bool reverse = false)
+    {
+        using visitor_type = typename std::remove_reference<Visitor>::type;
+        visit_surfaces([] (void *data, surface_interface_t *surface,
+                wf_point position)
+        {
+            (*static_cast<visitor_type*> (data))(surface, position);
+        }, (void*)&visitor, surface_origin, reverse);
+    }
+
     /**
      * @return The output the surface is currently attached to. Note this
      * doesn't necessarily mean that it is visible.
@@ -121,6 +146,16 @@ class surface_interface_t
      */
     virtual void send_frame_done(const timespec& frame_end);
 
+    /**
+     * Send wp_presentation feedback for the surface's current content.
+     * Surfaces which aren't backed by a wlr_surface don't need to do
+     * anything here.
+     *
+     * @param event The presentation event of the output the surface was
+     *        shown on.
+     */
+    virtual void send_presented(wlr_presentation_event& event);
+
     /**
      * Subtract the opaque region of the surface from region.
      *
@@ -178,6 +213,15 @@ class surface_interface_t
     /** @return the active shrink constraint */
     static int get_active_shrink_constraint();
 
+  private:
+    using surface_visit_func_t = void (*)(void *data,
+        surface_interface_t *surface, wf_point position);
+    /** The non-template part of for_each_surface() */
+    void visit_surfaces(surface_visit_func_t visit, void *data,
+        wf_point surface_origin, bool reverse);
+
+  protected:
+
     /**
      * Called when the reference count reaches 0.
      * It destructs the object and deletes it, so "this" may not be
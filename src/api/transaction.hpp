@@ -0,0 +1,59 @@
+#ifndef WF_TRANSACTION_HPP
+#define WF_TRANSACTION_HPP
+
+#include "view.hpp"
+#include "nonstd/noncopyable.hpp"
+
+namespace wf
+{
+/**
+ * A transaction changes the geometry of several views at once.
+ *
+ * When the transaction is committed, each view's current contents are
+ * frozen on screen and the new geometries are sent to the clients. Once all
+ * clients have committed buffers with their new size, or the timeout has
+ * passed, all views are unfrozen together, so the new layout appears in a
+ * single frame, without intermediate frames where only some of the views
+ * have been resized.
+ *
+ * Changes to a view which is unmapped or has no output are applied
+ * immediately on commit.
+ */
+class transaction_t : public noncopyable_t
+{
+  public:
+    /**
+     * @param timeout How long to wait for the clients after committing, in
+     *        milliseconds
+     */
+    transaction_t(uint32_t timeout = 200);
+
+    /** Commits the transaction if there are pending changes */
+    ~transaction_t();
+
+    /**
+     * Give the view a new geometry when the transaction is committed. Later
+     * calls for the same view replace the geometry set earlier.
+     *
+     * @param geometry The new wm geometry, in output-local coordinates
+     */
+    void set_geometry(wayfire_view view, wf_geometry geometry);
+
+    /** Change the maximized state of the view when the transaction is
+     * committed, before the new geometry is set. */
+    void set_maximized(wayfire_view view, bool maximized);
+
+    /**
+     * Apply all changes. The transaction is then empty and can be reused.
+     * The caller doesn't need to keep the transaction around for the
+     * clients to be waited for.
+     */
+    void commit();
+
+  private:
+    class impl;
+    std::unique_ptr<impl> pimpl;
+};
+}
+
+#endif /* end of include guard: WF_TRANSACTION_HPP */
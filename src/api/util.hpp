@@ -194,6 +194,33 @@ namespace wf
         callback_t call;
         wl_event_source *source = NULL;
     };
+
+    /**
+     * A histogram of latencies with a resolution of 1ms. Latencies of 100ms
+     * or more are counted in the last bucket.
+     */
+    struct latency_histogram_t
+    {
+        static constexpr int BUCKETS = 101;
+        uint64_t buckets[BUCKETS] = {0};
+
+        uint64_t count = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+
+        /** Add a latency, in microseconds */
+        void add(int64_t latency_us);
+
+        /** @return The average latency in milliseconds, or 0 if empty */
+        double get_average() const;
+
+        /**
+         * @param percentile A percentile in the range [0, 100]
+         * @return The upper bound in milliseconds of the bucket containing
+         *         the given percentile, or 0 if empty
+         */
+        int get_percentile(double percentile) const;
+    };
 }
 
 #define GetTuple(x,y,t) auto x = std::get<0>(t); \
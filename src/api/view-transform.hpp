@@ -4,6 +4,7 @@
 #include "view.hpp"
 #include "opengl.hpp"
 #include "debug.hpp"
+#include <glm/mat3x3.hpp>
 
 enum wf_transformer_z_order
 {
@@ -99,8 +100,24 @@ class wf_3D_view : public wf_view_transformer_t
         glm::mat4 view_proj{1.0}, translation{1.0}, rotation{1.0}, scaling{1.0};
         glm::vec4 color{1, 1, 1, 1};
 
+        /* The product of the matrices above. The result is cached until one
+         * of them or the size of the output changes. */
         glm::mat4 calculate_total_transform();
 
+    private:
+        struct
+        {
+            glm::mat4 view_proj, translation, rotation, scaling;
+            int output_width = -1, output_height = -1;
+
+            glm::mat4 total;
+            /* Maps points on the screen back to the view's plane */
+            glm::mat3 inverse;
+            bool invertible;
+        } cache;
+
+        void update_cache();
+
     public:
         wf_3D_view(wayfire_view view);
 
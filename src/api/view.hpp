@@ -116,6 +116,16 @@ class view_interface_t : public surface_interface_t, public wf::object_base_t
      */
     virtual void request_native_size();
 
+    /**
+     * Views limit the resizes which the client hasn't applied yet to one.
+     * Sizes requested meanwhile are coalesced, and only the last one is sent
+     * afterwards. When all resizes have been applied, the view emits
+     * resize-done.
+     *
+     * @return true if the client hasn't applied the last requested size yet.
+     */
+    virtual bool has_pending_resize();
+
     /** Request that the view closes. */
     virtual void close();
 
@@ -347,6 +357,14 @@ class view_interface_t : public surface_interface_t, public wf::object_base_t
      */
     virtual void take_snapshot();
 
+    /**
+     * Render the view, including its transformers, into the given framebuffer.
+     * The framebuffer is allocated to cover the view's bounding box at the
+     * scale of the view's output, and cleared beforehand. The caller owns it
+     * and has to release it.
+     */
+    void render_snapshot(wf_framebuffer& framebuffer);
+
     virtual ~view_interface_t();
 
     class view_priv_impl;
@@ -170,6 +170,21 @@ class workspace_manager
      */
     std::tuple<int, int> get_workspace_grid_size();
 
+    /**
+     * Views in the middle layers are not moved when the current workspace
+     * changes. Instead, their output-local coordinates are computed relative
+     * to the viewport origin, which moves by one output size for each
+     * workspace step. Views still report and accept output-local coordinates
+     * relative to the current workspace.
+     *
+     * Plugins which need positions that don't change when switching
+     * workspaces can add the viewport origin to the view's geometry.
+     *
+     * @return The position of the current workspace in the coordinates of
+     * the whole workspace grid
+     */
+    wf_point get_viewport_origin();
+
     /**
      * Special clients like panels can reserve place from an edge of the output.
      * It is used when calculating the dimensions of maximized/tiled windows and
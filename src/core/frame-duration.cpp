@@ -0,0 +1,58 @@
+#include "frame-duration.hpp"
+#include <algorithm>
+
+wf::frame_duration_t::frame_duration_t(wf_option duration,
+    std::function<double(double)> smooth)
+    : duration(duration), smooth_function(smooth) { }
+
+void wf::frame_duration_t::start(uint32_t frame_time)
+{
+    this->start_time = this->frame_time = frame_time;
+    this->length = duration ? duration->as_cached_int() : 0;
+    this->is_running = length > 0;
+}
+
+void wf::frame_duration_t::start(uint32_t frame_time, double start, double end)
+{
+    transition = {start, end};
+    this->start(frame_time);
+}
+
+void wf::frame_duration_t::set_frame_time(uint32_t frame_time)
+{
+    this->frame_time = frame_time;
+
+    /* Frame times wrap around, compare them as a difference */
+    if (is_running && (int32_t)(frame_time - start_time) >= length)
+        is_running = false;
+}
+
+double wf::frame_duration_t::progress_percentage()
+{
+    if (!is_running)
+        return 1.0;
+
+    /* A frame scheduled before the animation was started */
+    double elapsed = std::max<int32_t>(frame_time - start_time, 0);
+    return smooth_function(std::min(elapsed / length, 1.0));
+}
+
+double wf::frame_duration_t::progress()
+{
+    return progress(transition);
+}
+
+double wf::frame_duration_t::progress(double start, double end)
+{
+    return start + (end - start) * progress_percentage();
+}
+
+double wf::frame_duration_t::progress(const wf_transition& transition)
+{
+    return progress(transition.start, transition.end);
+}
+
+bool wf::frame_duration_t::running()
+{
+    return is_running;
+}
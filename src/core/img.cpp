@@ -1,6 +1,7 @@
 #include "img.hpp"
 #include "opengl.hpp"
 #include "debug.hpp"
+#include "core.hpp"
 
 #ifdef BUILD_WITH_IMAGEIO
 #include <png.h>
@@ -10,30 +11,66 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <csetjmp>
 #include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
 #include <unordered_map>
 #include <functional>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <list>
+#include <map>
 
 #define TEXTURE_LOAD_ERROR 0
 
 namespace image_io {
-    using Loader = std::function<bool(const char *, GLuint)>;
+    /* Loaders decode the image from memory. They are called from worker
+     * threads, so they must not touch any GL state */
+    using Loader = std::function<bool(const uint8_t *data, size_t size, image_t&)>;
     using Writer = std::function<void(const char *name, uint8_t *pixels, unsigned long, unsigned long)>;
+    /* Image writers are called from worker threads */
+    using ImageWriter = std::function<void(const char *name, const image_t&)>;
     namespace {
         std::unordered_map<std::string, Loader> loaders;
         std::unordered_map<std::string, Writer> writers;
+        std::unordered_map<std::string, ImageWriter> image_writers;
     }
 
 #ifdef BUILD_WITH_IMAGEIO
     /* All backend functions are taken from the internet.
      * If you want to be credited, contact me */
-    bool texture_from_png(const char *filename, GLuint target)
+    struct png_memory_reader_t
+    {
+        const uint8_t *data;
+        size_t size;
+        size_t offset;
+    };
+
+    static void png_read_from_memory(png_structp png, png_bytep out, png_size_t length)
+    {
+        auto reader = static_cast<png_memory_reader_t*> (png_get_io_ptr(png));
+        if (reader->offset + length > reader->size)
+            png_error(png, "unexpected end of file");
+
+        std::memcpy(out, reader->data + reader->offset, length);
+        reader->offset += length;
+    }
+
+    bool image_from_png(const uint8_t *file_data, size_t file_size, image_t& result)
     {
-        FILE *fp = fopen(filename, "rb");
         int width, height;
         png_byte color_type;
         png_byte bit_depth;
-        png_bytep *row_pointers;
+        std::vector<png_bytep> row_pointers;
+        png_memory_reader_t reader = {file_data, file_size, 0};
 
         png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
         if(!png)
@@ -41,12 +78,18 @@ namespace image_io {
 
         png_infop infos = png_create_info_struct(png);
         if(!infos)
+        {
+            png_destroy_read_struct(&png, NULL, NULL);
             return false;
+        }
 
         if(setjmp(png_jmpbuf(png)))
+        {
+            png_destroy_read_struct(&png, &infos, NULL);
             return false;
+        }
 
-        png_init_io(png, fp);
+        png_set_read_fn(png, &reader, png_read_from_memory);
         png_read_info(png, infos);
 
         width      = png_get_image_width(png, infos);
@@ -79,27 +122,24 @@ namespace image_io {
 
         png_read_update_info(png, infos);
 
-        row_pointers = new png_bytep[height];
-        png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
-
+        auto rowbytes = png_get_rowbytes(png, infos);
+        result.pixels.resize(height * rowbytes);
+        row_pointers.resize(height);
         for(int i = 0; i < height; i++)
-        {
-            row_pointers[i] = data + i * png_get_rowbytes(png, infos);
-        }
-
-        png_read_image(png, row_pointers);
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-                             GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *) data));
+            row_pointers[i] = result.pixels.data() + i * rowbytes;
 
+        png_read_image(png, row_pointers.data());
         png_destroy_read_struct(&png, &infos, NULL);
-        delete[] row_pointers;
-        delete[] data;
 
-        fclose(fp);
+        result.width = width;
+        result.height = height;
+        result.format = GL_RGBA;
         return true;
     }
 
-    void texture_to_png(const char *name, uint8_t *pixels, int w, int h)
+    /* Write the given rows, top row first, to a png file */
+    static void write_png_rows(const char *name, png_bytep *rows, int w, int h,
+        int color_type)
     {
         png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
         if (!png)
@@ -113,91 +153,155 @@ namespace image_io {
 
         FILE *fp = fopen(name, "wb");
         if (!fp) {
+            log_error("failed to open %s for writing", name);
             png_destroy_write_struct(&png, &infot);
             return;
         }
 
-        png_init_io(png, fp);
-        png_set_IHDR(png, infot, w, h, 8 /* depth */, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
-                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-        png_colorp palette = (png_colorp)png_malloc(png, PNG_MAX_PALETTE_LENGTH * sizeof(png_color));
-        if (!palette) {
-            fclose(fp);
+        if (setjmp(png_jmpbuf(png))) {
+            log_error("failed to write png image %s", name);
             png_destroy_write_struct(&png, &infot);
+            fclose(fp);
             return;
         }
-        png_set_PLTE(png, infot, palette, PNG_MAX_PALETTE_LENGTH);
+
+        png_init_io(png, fp);
+        png_set_IHDR(png, infot, w, h, 8 /* depth */, color_type, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
         png_write_info(png, infot);
         png_set_packing(png);
 
-        png_bytepp rows = (png_bytepp)png_malloc(png, h * sizeof(png_bytep));
-        for (int i = 0; i < h; ++i)
-            rows[i] = (png_bytep)(pixels + (h - i) * w * 4);
-
         png_write_image(png, rows);
         png_write_end(png, infot);
-        png_free(png, palette);
         png_destroy_write_struct(&png, &infot);
 
         fclose(fp);
-        delete[] rows;
     }
 
-    bool texture_from_jpeg(const char *FileName, GLuint target)
+    /* pixels are in GL order, i.e bottom row first */
+    void texture_to_png(const char *name, uint8_t *pixels, int w, int h)
+    {
+        std::vector<png_bytep> rows(h);
+        for (int i = 0; i < h; ++i)
+            rows[i] = (png_bytep)(pixels + (h - i - 1) * w * 4);
+
+        write_png_rows(name, rows.data(), w, h, PNG_COLOR_TYPE_RGBA);
+    }
+
+    void image_to_png(const char *name, const image_t& image)
+    {
+        int channels = image.format == GL_RGBA ? 4 : 3;
+        std::vector<png_bytep> rows(image.height);
+        for (int i = 0; i < image.height; ++i)
+        {
+            rows[i] = const_cast<png_bytep> (
+                image.pixels.data() + i * image.width * channels);
+        }
+
+        write_png_rows(name, rows.data(), image.width, image.height,
+            image.format == GL_RGBA ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB);
+    }
+
+    struct jpeg_error_handler_t
+    {
+        jpeg_error_mgr mgr;
+        std::jmp_buf on_error;
+    };
+
+    /* The default handler calls exit(), which we certainly don't want */
+    static void jpeg_handle_error(j_common_ptr info)
+    {
+        char message[JMSG_LENGTH_MAX];
+        info->err->format_message(info, message);
+        log_error("failed to decode JPEG image: %s", message);
+
+        auto handler = reinterpret_cast<jpeg_error_handler_t*> (info->err);
+        std::longjmp(handler->on_error, 1);
+    }
+
+    bool image_from_jpeg(const uint8_t *file_data, size_t file_size, image_t& result)
     {
-        unsigned long data_size;
         unsigned char *rowptr[1];
-        unsigned char *jdata;
         struct jpeg_decompress_struct infot;
-        struct jpeg_error_mgr err;
+        jpeg_error_handler_t err;
 
-        std::FILE *file = fopen(FileName, "rb");
-        infot.err = jpeg_std_error(& err);
-        jpeg_create_decompress(&infot);
-
-        if(!file)
+        infot.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpeg_handle_error;
+        if (setjmp(err.on_error))
         {
-            log_error("failed to read JPEG file %s", FileName);
+            jpeg_destroy_decompress(&infot);
             return false;
         }
 
-        jpeg_stdio_src(&infot, file);
+        jpeg_create_decompress(&infot);
+        jpeg_mem_src(&infot, const_cast<uint8_t*> (file_data), file_size);
         jpeg_read_header(&infot, TRUE);
-        jpeg_start_decompress(&infot);
 
-        data_size = infot.output_width * infot.output_height * 3;
+        infot.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&infot);
 
-        jdata = new unsigned char[data_size];
+        result.pixels.resize(infot.output_width * infot.output_height * 3);
         while (infot.output_scanline < infot.output_height) {
-            rowptr[0] = (unsigned char *)jdata +  3* infot.output_width * infot.output_scanline;
+            rowptr[0] = result.pixels.data() + 3 * infot.output_width * infot.output_scanline;
             jpeg_read_scanlines(&infot, rowptr, 1);
         }
 
         jpeg_finish_decompress(&infot);
 
-        GL_CALL(glTexImage2D(target, 0, GL_RGB,
-                infot.output_width, infot.output_height,
-                0, GL_RGB, GL_UNSIGNED_BYTE, jdata));
-
-        fclose(file);
-        delete[] jdata;
+        result.width = infot.output_width;
+        result.height = infot.output_height;
+        result.format = GL_RGB;
 
+        jpeg_destroy_decompress(&infot);
         return true;
     }
 #endif
 
-    bool load_from_file(std::string name, GLuint target)
+    namespace
+    {
+        /* How many decoded images to keep around after they were loaded */
+        const size_t max_cached_images = 4;
+
+        using decode_result_t = std::shared_future<std::shared_ptr<const image_t>>;
+
+        /* Decoded images, keyed by a hash of the file contents. Entries are
+         * added before decoding starts, so concurrent loads of the same image
+         * wait for the first decode instead of repeating it */
+        struct
+        {
+            std::mutex lock;
+            std::map<uint64_t, decode_result_t> images;
+            /* Most recently used first */
+            std::list<uint64_t> lru;
+        } decode_cache;
+
+        /* FNV-1a */
+        uint64_t hash_contents(const uint8_t *data, size_t size)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= data[i];
+                hash *= 1099511628211ull;
+            }
+
+            return hash ^ size;
+        }
+    }
+
+    /* Find the loader for the file, based on its extension */
+    static const Loader* find_loader(const std::string& name)
     {
         if (access(name.c_str(), F_OK) == -1) {
             if (!name.empty())
                 log_error("%s() cannot access \"%s\"", __func__, name.c_str());
-            return false;
+            return nullptr;
         }
 
         int len = name.length();
         if (len < 4 || name[len - 4] != '.') {
             log_error("load_from_file() called with file without extension or with invalid extension!");
-            return false;
+            return nullptr;
         }
 
         auto ext = name.substr(len - 3, 3);
@@ -207,10 +311,287 @@ namespace image_io {
         auto it = loaders.find(ext);
         if (it == loaders.end()) {
             log_error("load_from_file() called with unsupported extension %s", ext.c_str());
-            return false;
-        } else {
-            return it->second(name.c_str(), target);
+            return nullptr;
+        }
+
+        return &it->second;
+    }
+
+    std::shared_ptr<const image_t> decode_file(std::string name)
+    {
+        auto loader = find_loader(name);
+        if (!loader)
+            return nullptr;
+
+        int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0)
+        {
+            log_error("failed to open image file %s", name.c_str());
+            if (fd >= 0)
+                close(fd);
+            return nullptr;
+        }
+
+        size_t size = st.st_size;
+        void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            log_error("failed to map image file %s", name.c_str());
+            return nullptr;
         }
+
+        auto data = static_cast<const uint8_t*> (mapped);
+        uint64_t hash = hash_contents(data, size);
+
+        std::promise<std::shared_ptr<const image_t>> promise;
+        decode_result_t cached;
+        bool need_decode = false;
+        {
+            std::lock_guard<std::mutex> guard(decode_cache.lock);
+            auto it = decode_cache.images.find(hash);
+            if (it == decode_cache.images.end())
+            {
+                need_decode = true;
+                cached = promise.get_future().share();
+                decode_cache.images[hash] = cached;
+            } else
+            {
+                cached = it->second;
+                decode_cache.lru.remove(hash);
+            }
+
+            decode_cache.lru.push_front(hash);
+            while (decode_cache.lru.size() > max_cached_images)
+            {
+                decode_cache.images.erase(decode_cache.lru.back());
+                decode_cache.lru.pop_back();
+            }
+        }
+
+        if (need_decode)
+        {
+            auto image = std::make_shared<image_t> ();
+            if ((*loader)(data, size, *image))
+            {
+                promise.set_value(image);
+            } else
+            {
+                promise.set_value(nullptr);
+
+                /* Don't keep failures around, the file might get fixed */
+                std::lock_guard<std::mutex> guard(decode_cache.lock);
+                decode_cache.images.erase(hash);
+                decode_cache.lru.remove(hash);
+            }
+        }
+
+        munmap(mapped, size);
+        return cached.get();
+    }
+
+    void upload_to_texture(const image_t& image, GLuint target)
+    {
+        /* RGB rows aren't necessarily 4-byte aligned */
+        GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        GL_CALL(glTexImage2D(target, 0, image.format, image.width, image.height,
+                0, image.format, GL_UNSIGNED_BYTE, image.pixels.data()));
+        GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
+
+    bool load_from_file(std::string name, GLuint target)
+    {
+        auto image = decode_file(name);
+        if (!image)
+            return false;
+
+        upload_to_texture(*image, target);
+        return true;
+    }
+
+    struct async_load_t::state_t
+    {
+        std::string name;
+        callback_t callback;
+        std::shared_ptr<const image_t> result;
+
+        std::atomic<bool> cancelled{false};
+        bool done = false;
+    };
+
+    namespace
+    {
+        /**
+         * Worker threads for decoding and encoding images. Each task runs
+         * its work on a worker thread, and then its (optional) completion
+         * on the main thread, dispatched through an eventfd on the core
+         * event loop.
+         */
+        class image_task_pool_t
+        {
+            struct task_t
+            {
+                std::function<void()> work;
+                std::function<void()> done;
+            };
+
+            std::mutex lock;
+            std::condition_variable has_work;
+            std::deque<task_t> tasks;
+            std::vector<task_t> finished;
+            bool quit = false;
+
+            int wake_fd;
+            std::vector<std::thread> workers;
+
+            void worker_main()
+            {
+                while (true)
+                {
+                    task_t task;
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        has_work.wait(guard, [=] () { return quit || !tasks.empty(); });
+                        if (quit)
+                            return;
+
+                        task = std::move(tasks.front());
+                        tasks.pop_front();
+                    }
+
+                    task.work();
+                    if (!task.done)
+                        continue;
+
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        finished.push_back(std::move(task));
+                    }
+
+                    uint64_t one = 1;
+                    write(wake_fd, &one, sizeof(one));
+                }
+            }
+
+            static int handle_finished(int fd, uint32_t mask, void *data)
+            {
+                uint64_t count;
+                read(fd, &count, sizeof(count));
+                static_cast<image_task_pool_t*> (data)->dispatch_finished();
+                return 0;
+            }
+
+            void dispatch_finished()
+            {
+                std::vector<task_t> ready;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    std::swap(ready, finished);
+                }
+
+                for (auto& task : ready)
+                    task.done();
+            }
+
+          public:
+            image_task_pool_t()
+            {
+                wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+                wl_event_loop_add_fd(wf::get_core().ev_loop, wake_fd,
+                    WL_EVENT_READABLE, handle_finished, this);
+
+                int num_workers =
+                    clamp<int>(std::thread::hardware_concurrency(), 1, 4);
+                for (int i = 0; i < num_workers; i++)
+                    workers.emplace_back([=] () { worker_main(); });
+            }
+
+            /* Destroyed at exit, after the event loop is gone */
+            ~image_task_pool_t()
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    quit = true;
+                }
+
+                has_work.notify_all();
+                for (auto& worker : workers)
+                    worker.join();
+
+                close(wake_fd);
+            }
+
+            /* @return The number of tasks which haven't been started yet */
+            size_t get_queued()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                return tasks.size();
+            }
+
+            void push(std::function<void()> work, std::function<void()> done)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    tasks.push_back({work, done});
+                }
+
+                has_work.notify_one();
+            }
+
+            static image_task_pool_t& get()
+            {
+                static image_task_pool_t pool;
+                return pool;
+            }
+        };
+    }
+
+    async_load_t::~async_load_t()
+    {
+        cancel();
+    }
+
+    void async_load_t::start(std::string name, callback_t callback)
+    {
+        cancel();
+
+        auto job = std::make_shared<state_t> ();
+        job->name = name;
+        job->callback = callback;
+
+        auto work = [job] ()
+        {
+            if (!job->cancelled)
+                job->result = decode_file(job->name);
+        };
+
+        auto done = [job] ()
+        {
+            if (job->cancelled)
+                return;
+
+            /* The callback may destroy or restart the request */
+            job->done = true;
+            auto callback = std::move(job->callback);
+            callback(std::move(job->result));
+        };
+
+        state = job;
+        image_task_pool_t::get().push(work, done);
+    }
+
+    void async_load_t::cancel()
+    {
+        if (state)
+            state->cancelled = true;
+
+        state.reset();
+    }
+
+    bool async_load_t::is_pending() const
+    {
+        return state && !state->done;
     }
 
     void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type)
@@ -226,13 +607,35 @@ namespace image_io {
         }
     }
 
+    void write_to_file_async(std::string name,
+        std::shared_ptr<const image_t> image, std::string type)
+    {
+        auto it = image_writers.find(type);
+        if (it == image_writers.end())
+        {
+            log_error("unsupported image_writer backend");
+            return;
+        }
+
+        auto writer = it->second;
+        image_task_pool_t::get().push([=] () {
+            writer(name.c_str(), *image);
+        }, nullptr);
+    }
+
+    size_t get_pending_writes()
+    {
+        return image_task_pool_t::get().get_queued();
+    }
+
     void init()
     {
         log_debug("init ImageIO");
 #ifdef BUILD_WITH_IMAGEIO
-        loaders["png"] = Loader(texture_from_png);
-        loaders["jpg"] = Loader(texture_from_jpeg);
+        loaders["png"] = Loader(image_from_png);
+        loaders["jpg"] = Loader(image_from_jpeg);
         writers["png"] = Writer(texture_to_png);
+        image_writers["png"] = ImageWriter(image_to_png);
 #endif
     }
 }
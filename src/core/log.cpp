@@ -0,0 +1,425 @@
+#include "debug.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace wf
+{
+namespace log
+{
+namespace
+{
+constexpr size_t QUEUE_SIZE = 1024;
+constexpr size_t MAX_MESSAGE = 496;
+
+int64_t get_time_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+struct message_t
+{
+    std::atomic<size_t> sequence;
+
+    wlr_log_importance verbosity;
+    subsystem_t *subsystem;
+    const char *file;
+    int line;
+    int64_t time;
+    char text[MAX_MESSAGE];
+};
+
+/**
+ * A bounded multi-producer multi-consumer queue, as described by Dmitry
+ * Vyukov. Each message slot has a sequence number which tells whether it
+ * is free for the producer or ready for the consumer at a given position,
+ * so producers only contend on a single compare-and-swap.
+ */
+class message_queue_t
+{
+    message_t messages[QUEUE_SIZE];
+    std::atomic<size_t> enqueue_pos{0};
+    std::atomic<size_t> dequeue_pos{0};
+
+  public:
+    std::atomic<uint64_t> dropped{0};
+
+    message_queue_t()
+    {
+        for (size_t i = 0; i < QUEUE_SIZE; i++)
+            messages[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return A free message, which must be handed to push() after it has
+     * been filled, or null if the queue is full.
+     */
+    message_t *reserve(size_t& pos)
+    {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& msg = messages[pos % QUEUE_SIZE];
+            auto seq = msg.sequence.load(std::memory_order_acquire);
+            auto diff = (intptr_t)seq - (intptr_t)pos;
+
+            if (diff == 0)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed))
+                {
+                    return &msg;
+                }
+            } else if (diff < 0)
+            {
+                return nullptr;
+            } else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(message_t *msg, size_t pos)
+    {
+        msg->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    /** @return The next ready message, which must be released with pop(),
+     * or null if the queue is empty */
+    message_t *front(size_t& pos)
+    {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& msg = messages[pos % QUEUE_SIZE];
+            auto seq = msg.sequence.load(std::memory_order_acquire);
+            auto diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (diff == 0)
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed))
+                {
+                    return &msg;
+                }
+            } else if (diff < 0)
+            {
+                return nullptr;
+            } else
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void pop(message_t *msg, size_t pos)
+    {
+        msg->sequence.store(pos + QUEUE_SIZE, std::memory_order_release);
+    }
+};
+
+struct logger_t
+{
+    std::mutex lock;
+    std::map<std::string, subsystem_t*> subsystems;
+    std::map<std::string, int> filters;
+    int default_verbosity = WLR_ERROR;
+
+    message_queue_t queue;
+    int64_t start_time = get_time_us();
+
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    /* The logging thread blocks on the eventfd while the queue is empty.
+     * pending counts the messages which haven't been written out yet, so
+     * only the producer which makes the queue non-empty wakes it up. */
+    int wakeup_fd = -1;
+    std::atomic<int64_t> pending{0};
+
+    void wake_up()
+    {
+        uint64_t one = 1;
+        while (::write(wakeup_fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {}
+    }
+};
+
+/* Never destroyed, so that logging works until the very end */
+logger_t& get_logger()
+{
+    static auto logger = new logger_t;
+    return *logger;
+}
+
+void append_message(std::string& out, wlr_log_importance verbosity,
+    subsystem_t *subsystem, const char *file, int line, int64_t time,
+    const char *text)
+{
+    static const char *verbosity_names[] = {"S", "E", "I", "D"};
+
+    time -= get_logger().start_time;
+    int64_t ms = time / 1000;
+
+    char prefix[128];
+    int len = snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d [%s] [%s] ",
+        int(ms / 3600000), int(ms / 60000 % 60), int(ms / 1000 % 60),
+        int(ms % 1000), verbosity_names[verbosity % 4],
+        subsystem->name.c_str());
+    out.append(prefix, std::min<size_t>(len, sizeof(prefix) - 1));
+
+    /* Messages from wlroots already contain their location */
+    if (file)
+    {
+        len = snprintf(prefix, sizeof(prefix), "[%s:%d] ",
+            wf_strip_path(file), line);
+        out.append(prefix, std::min<size_t>(len, sizeof(prefix) - 1));
+    }
+
+    out += text;
+    out += '\n';
+}
+
+void write_out(const std::string& out)
+{
+    size_t written = 0;
+    while (written < out.size())
+    {
+        auto r = ::write(STDERR_FILENO, out.data() + written,
+            out.size() - written);
+        if (r <= 0)
+            break;
+
+        written += r;
+    }
+}
+
+/** @return Whether there were any messages */
+bool drain_queue()
+{
+    auto& logger = get_logger();
+
+    std::string out;
+    size_t pos;
+    int64_t count = 0;
+    while (auto msg = logger.queue.front(pos))
+    {
+        append_message(out, msg->verbosity, msg->subsystem, msg->file,
+            msg->line, msg->time, msg->text);
+        logger.queue.pop(msg, pos);
+        ++count;
+    }
+
+    logger.pending -= count;
+
+    auto dropped = logger.queue.dropped.exchange(0);
+    if (dropped)
+    {
+        out += "[logging] " + std::to_string(dropped) +
+            " messages dropped, the queue was full\n";
+    }
+
+    write_out(out);
+    return !out.empty();
+}
+
+void logging_thread()
+{
+    auto& logger = get_logger();
+    while (logger.running)
+    {
+        /* Messages pushed after the queue was drained, but counted before
+         * the drained ones were subtracted, didn't wake us up */
+        uint64_t wakeups;
+        if (logger.pending <= 0 &&
+            ::read(logger.wakeup_fd, &wakeups, sizeof(wakeups)) < 0 &&
+            errno != EINTR)
+        {
+            break;
+        }
+
+        drain_queue();
+    }
+}
+
+void handle_wlr_log(wlr_log_importance verbosity, const char *fmt,
+    va_list args)
+{
+    static auto subsystem = get_subsystem("wlroots");
+    if (verbosity <= subsystem->verbosity.load(std::memory_order_relaxed))
+        write_va(verbosity, subsystem, nullptr, 0, fmt, args);
+}
+
+int parse_verbosity(const std::string& name)
+{
+    if (name == "silent")
+        return WLR_SILENT;
+    if (name == "error")
+        return WLR_ERROR;
+    if (name == "info")
+        return WLR_INFO;
+    if (name == "debug")
+        return WLR_DEBUG;
+
+    return -1;
+}
+}
+
+subsystem_t *get_subsystem(const char *name)
+{
+    auto& logger = get_logger();
+    std::lock_guard<std::mutex> guard(logger.lock);
+
+    auto& subsystem = logger.subsystems[name];
+    if (!subsystem)
+    {
+        subsystem = new subsystem_t;
+        subsystem->name = name;
+
+        auto it = logger.filters.find(name);
+        subsystem->verbosity = (it == logger.filters.end() ?
+            logger.default_verbosity : it->second);
+    }
+
+    return subsystem;
+}
+
+void set_verbosity(wlr_log_importance verbosity, const std::string& filters)
+{
+    auto& logger = get_logger();
+    {
+        std::lock_guard<std::mutex> guard(logger.lock);
+        logger.default_verbosity = verbosity;
+        logger.filters.clear();
+
+        size_t start = 0;
+        while (start < filters.size())
+        {
+            size_t end = filters.find_first_of(" ,", start);
+            if (end == std::string::npos)
+                end = filters.size();
+
+            auto filter = filters.substr(start, end - start);
+            start = end + 1;
+            if (filter.empty())
+                continue;
+
+            auto colon = filter.find(':');
+            int level = colon == std::string::npos ?
+                -1 : parse_verbosity(filter.substr(colon + 1));
+
+            if (level < 0)
+            {
+                fprintf(stderr, "[logging] invalid log filter \"%s\"\n",
+                    filter.c_str());
+                continue;
+            }
+
+            logger.filters[filter.substr(0, colon)] = level;
+        }
+
+        for (auto& subsystem : logger.subsystems)
+        {
+            auto it = logger.filters.find(subsystem.first);
+            subsystem.second->verbosity = (it == logger.filters.end() ?
+                verbosity : it->second);
+        }
+    }
+
+    /* wlroots filters its messages before formatting them */
+    auto wlroots = get_subsystem("wlroots");
+    wlr_log_init(wlr_log_importance(wlroots->verbosity.load()), handle_wlr_log);
+}
+
+void write(wlr_log_importance verbosity, subsystem_t *subsystem,
+    const char *file, int line, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    write_va(verbosity, subsystem, file, line, fmt, args);
+    va_end(args);
+}
+
+void write_va(wlr_log_importance verbosity, subsystem_t *subsystem,
+    const char *file, int line, const char *fmt, va_list args)
+{
+    auto& logger = get_logger();
+    if (!logger.running)
+    {
+        char text[MAX_MESSAGE];
+        vsnprintf(text, sizeof(text), fmt, args);
+
+        std::string out;
+        append_message(out, verbosity, subsystem, file, line, get_time_us(),
+            text);
+        write_out(out);
+        return;
+    }
+
+    size_t pos;
+    auto msg = logger.queue.reserve(pos);
+    if (!msg)
+    {
+        ++logger.queue.dropped;
+        return;
+    }
+
+    msg->verbosity = verbosity;
+    msg->subsystem = subsystem;
+    msg->file = file;
+    msg->line = line;
+    msg->time = get_time_us();
+    vsnprintf(msg->text, sizeof(msg->text), fmt, args);
+    logger.queue.push(msg, pos);
+
+    if (logger.pending++ == 0)
+        logger.wake_up();
+}
+
+void start()
+{
+    auto& logger = get_logger();
+    if (logger.running)
+        return;
+
+    if (logger.wakeup_fd < 0)
+        logger.wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (logger.wakeup_fd < 0)
+    {
+        fprintf(stderr, "[logging] failed to create eventfd: %s, logging "
+            "synchronously\n", strerror(errno));
+        return;
+    }
+
+    logger.running = true;
+    logger.thread = std::thread(logging_thread);
+}
+
+void stop()
+{
+    auto& logger = get_logger();
+    if (!logger.running.exchange(false))
+        return;
+
+    logger.wake_up();
+
+    if (logger.thread.get_id() != std::this_thread::get_id())
+        logger.thread.join();
+    else
+        logger.thread.detach();
+
+    drain_queue();
+}
+}
+}
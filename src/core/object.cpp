@@ -1,5 +1,6 @@
 #include "object.hpp"
 #include "nonstd/safe-list.hpp"
+#include "trace.hpp"
 #include <unordered_map>
 
 class wf::signal_provider_t::sprovider_impl
@@ -34,6 +35,7 @@ void wf::signal_provider_t::disconnect_signal(std::string name,
 /* Emit the given signal. No type checking for data is required */
 void wf::signal_provider_t::emit_signal(std::string name, wf::signal_data_t *data)
 {
+    WF_TRACE_DETAIL("signal", "emit", name);
     sprovider_priv->signals[name].for_each([data] (auto call) {
         (*call) (data);
     });
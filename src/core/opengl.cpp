@@ -49,6 +49,44 @@ namespace OpenGL
         GLuint position, uvPosition;
     } program;
 
+    /* Program used to draw many textured triangles in one call */
+    struct
+    {
+        GLuint id;
+
+        GLuint hasAlphaID;
+        GLuint position, uvPosition;
+    } triangle_program;
+
+    static const char *triangle_vertex_source =
+R"(
+#version 100
+
+attribute mediump vec2 position;
+attribute mediump vec2 uvPosition;
+
+varying mediump vec2 uv;
+
+void main() {
+    uv = uvPosition;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+    static const char *triangle_fragment_source =
+R"(
+#version 100
+
+varying mediump vec2 uv;
+uniform sampler2D smp;
+uniform mediump float hasAlpha;
+
+void main() {
+    mediump vec4 color = texture2D(smp, uv);
+    gl_FragColor = vec4(color.rgb, mix(1.0, color.a, hasAlpha));
+}
+)";
+
     GLuint compile_shader_from_file(std::string path, std::string source, GLuint type)
     {
         GLuint shader = GL_CALL(glCreateShader(type));
@@ -137,6 +175,13 @@ namespace OpenGL
         program.position   = GL_CALL(glGetAttribLocation(program.id, "position"));
         program.uvPosition = GL_CALL(glGetAttribLocation(program.id, "uvPosition"));
 
+        triangle_program.id = create_program_from_source(
+            triangle_vertex_source, triangle_fragment_source);
+        auto& tp = triangle_program;
+        tp.hasAlphaID = GL_CALL(glGetUniformLocation(tp.id, "hasAlpha"));
+        tp.position   = GL_CALL(glGetAttribLocation(tp.id, "position"));
+        tp.uvPosition = GL_CALL(glGetAttribLocation(tp.id, "uvPosition"));
+
         render_end();
     }
 
@@ -144,29 +189,274 @@ namespace OpenGL
     {
         render_begin();
         GL_CALL(glDeleteProgram(program.id));
+        GL_CALL(glDeleteProgram(triangle_program.id));
         render_end();
     }
 
     namespace
     {
         wf::output_t *current_output = NULL;
+
+        /* Bindings are cached only for the first few texture units */
+        constexpr int MAX_TEXTURE_UNITS = 8;
+
+        /* The GL_TEXTURE_2D binding of a texture unit, and the parameters
+         * of the bound texture. Values are -1 if the state isn't known. */
+        struct texture_unit_t
+        {
+            int64_t texture;
+            int64_t min_filter, mag_filter;
+            int64_t wrap_s, wrap_t;
+
+            void reset_params()
+            {
+                min_filter = mag_filter = wrap_s = wrap_t = -1;
+            }
+
+            void reset()
+            {
+                texture = -1;
+                reset_params();
+            }
+
+            /** @return The cached value of the parameter, or nullptr if
+             *  the parameter isn't cached */
+            int64_t* get_param(GLenum pname)
+            {
+                switch (pname)
+                {
+                    case GL_TEXTURE_MIN_FILTER:
+                        return &min_filter;
+                    case GL_TEXTURE_MAG_FILTER:
+                        return &mag_filter;
+                    case GL_TEXTURE_WRAP_S:
+                        return &wrap_s;
+                    case GL_TEXTURE_WRAP_T:
+                        return &wrap_t;
+                    default:
+                        return nullptr;
+                }
+            }
+        };
+
+        /* Values are -1 if the state isn't known */
+        struct
+        {
+            int64_t program;
+            int64_t active_unit;
+            texture_unit_t texture_2d[MAX_TEXTURE_UNITS];
+            int64_t draw_fb, read_fb;
+            int64_t blend, depth_test;
+            int64_t blend_src, blend_dst;
+        } state;
+
+        state_stats_t frame_stats, last_frame_stats;
+
+        /** @return true if the call needs to be issued, and update the
+         *  cached value */
+        bool update_state(int64_t& cached, int64_t value)
+        {
+            if (cached == value)
+            {
+                ++frame_stats.filtered;
+                return false;
+            }
+
+            cached = value;
+            ++frame_stats.issued;
+            return true;
+        }
+
+        int64_t* get_capability(GLenum capability)
+        {
+            switch (capability)
+            {
+                case GL_BLEND:
+                    return &state.blend;
+                case GL_DEPTH_TEST:
+                    return &state.depth_test;
+                default:
+                    return nullptr;
+            }
+        }
+
+        /** @return The cached GL_TEXTURE_2D state of the active unit */
+        texture_unit_t* get_active_unit()
+        {
+            if (state.active_unit < 0 || state.active_unit >= MAX_TEXTURE_UNITS)
+                return nullptr;
+
+            return &state.texture_2d[state.active_unit];
+        }
+
+        void reset_texture_units()
+        {
+            for (auto& unit : state.texture_2d)
+                unit.reset();
+        }
+    }
+
+    void invalidate_state()
+    {
+        state.program = state.active_unit = -1;
+        reset_texture_units();
+        state.draw_fb = state.read_fb = -1;
+        state.blend = state.depth_test = -1;
+        state.blend_src = state.blend_dst = -1;
+    }
+
+    void use_program(GLuint program)
+    {
+        if (update_state(state.program, program))
+        {
+            GL_CALL(glUseProgram(program));
+        }
+    }
+
+    void active_texture(GLenum unit)
+    {
+        if (update_state(state.active_unit, unit - GL_TEXTURE0))
+        {
+            GL_CALL(glActiveTexture(unit));
+        }
+    }
+
+    void bind_texture(GLenum target, GLuint tex)
+    {
+        auto unit = get_active_unit();
+        if (target != GL_TEXTURE_2D || !unit)
+        {
+            ++frame_stats.issued;
+            /* We don't know which unit's binding changes */
+            if (target == GL_TEXTURE_2D)
+                reset_texture_units();
+
+            GL_CALL(glBindTexture(target, tex));
+            return;
+        }
+
+        if (update_state(unit->texture, tex))
+        {
+            unit->reset_params();
+            GL_CALL(glBindTexture(target, tex));
+        }
+    }
+
+    void bind_framebuffer(GLenum target, GLuint fb)
+    {
+        if (target == GL_FRAMEBUFFER)
+        {
+            if (state.draw_fb == fb && state.read_fb == fb)
+            {
+                ++frame_stats.filtered;
+                return;
+            }
+
+            ++frame_stats.issued;
+            state.draw_fb = state.read_fb = fb;
+            GL_CALL(glBindFramebuffer(target, fb));
+            return;
+        }
+
+        auto& cached = (target == GL_READ_FRAMEBUFFER ?
+            state.read_fb : state.draw_fb);
+        if (update_state(cached, fb))
+        {
+            GL_CALL(glBindFramebuffer(target, fb));
+        }
+    }
+
+    void enable(GLenum capability)
+    {
+        auto cached = get_capability(capability);
+        if (!cached || update_state(*cached, 1))
+        {
+            if (!cached)
+                ++frame_stats.issued;
+            GL_CALL(glEnable(capability));
+        }
+    }
+
+    void disable(GLenum capability)
+    {
+        auto cached = get_capability(capability);
+        if (!cached || update_state(*cached, 0))
+        {
+            if (!cached)
+                ++frame_stats.issued;
+            GL_CALL(glDisable(capability));
+        }
+    }
+
+    void blend_func(GLenum sfactor, GLenum dfactor)
+    {
+        if (state.blend_src == sfactor && state.blend_dst == dfactor)
+        {
+            ++frame_stats.filtered;
+            return;
+        }
+
+        ++frame_stats.issued;
+        state.blend_src = sfactor;
+        state.blend_dst = dfactor;
+        GL_CALL(glBlendFunc(sfactor, dfactor));
+    }
+
+    void tex_parameter(GLenum target, GLenum pname, GLint value)
+    {
+        auto unit = get_active_unit();
+        auto cached = (target == GL_TEXTURE_2D && unit && unit->texture >= 0) ?
+            unit->get_param(pname) : nullptr;
+        if (!cached)
+        {
+            ++frame_stats.issued;
+            if (target == GL_TEXTURE_2D)
+            {
+                /* The texture may also be bound on other units */
+                for (auto& other : state.texture_2d)
+                    other.reset_params();
+            }
+
+            GL_CALL(glTexParameteri(target, pname, value));
+            return;
+        }
+
+        if (update_state(*cached, value))
+        {
+            /* Other units which have the same texture bound now have
+             * stale parameters */
+            for (auto& other : state.texture_2d)
+            {
+                if (&other != unit && other.texture == unit->texture)
+                    other.reset_params();
+            }
+
+            GL_CALL(glTexParameteri(target, pname, value));
+        }
+    }
+
+    state_stats_t get_state_stats()
+    {
+        return last_frame_stats;
     }
 
     void bind_output(wf::output_t *output)
     {
         current_output = output;
+        frame_stats = {};
     }
 
     void unbind_output(wf::output_t *output)
     {
         current_output = NULL;
+        last_frame_stats = frame_stats;
     }
 
     void render_transformed_texture(GLuint tex,
         const gl_geometry& g, const gl_geometry& texg,
         glm::mat4 model, glm::vec4 color, uint32_t bits)
     {
-        GL_CALL(glUseProgram(program.id));
+        use_program(program.id);
 
         gl_geometry final_g = g;
         if (bits & TEXTURE_TRANSFORM_INVERT_Y)
@@ -195,8 +485,8 @@ namespace OpenGL
             coordData[6] = texg.x1; coordData[7] = texg.y1;
         }
 
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL_CALL(glActiveTexture(GL_TEXTURE0));
+        active_texture(GL_TEXTURE0);
+        bind_texture(GL_TEXTURE_2D, tex);
 
         GL_CALL(glVertexAttribPointer(program.position, 2, GL_FLOAT, GL_FALSE, 0, vertexData));
         GL_CALL(glEnableVertexAttribArray(program.position));
@@ -207,14 +497,47 @@ namespace OpenGL
         GL_CALL(glUniformMatrix4fv(program.mvpID, 1, GL_FALSE, &model[0][0]));
         GL_CALL(glUniform4fv(program.colorID, 1, &color[0]));
 
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+        enable(GL_BLEND);
+        blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
         GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
 
         GL_CALL(glDisableVertexAttribArray(program.uvPosition));
         GL_CALL(glDisableVertexAttribArray(program.position));
     }
 
+    void render_textured_triangles(GLuint tex,
+        const std::vector<GLfloat>& vertex_data, bool has_alpha)
+    {
+        if (vertex_data.empty())
+            return;
+
+        auto& tp = triangle_program;
+        use_program(tp.id);
+
+        active_texture(GL_TEXTURE0);
+        bind_texture(GL_TEXTURE_2D, tex);
+        /* wlroots sets the filters only when it renders a texture itself,
+         * and the default minification filter needs mipmaps */
+        tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GL_CALL(glUniform1f(tp.hasAlphaID, has_alpha ? 1.0 : 0.0));
+
+        const GLsizei stride = 4 * sizeof(GLfloat);
+        GL_CALL(glVertexAttribPointer(tp.position, 2, GL_FLOAT, GL_FALSE,
+                stride, vertex_data.data()));
+        GL_CALL(glEnableVertexAttribArray(tp.position));
+        GL_CALL(glVertexAttribPointer(tp.uvPosition, 2, GL_FLOAT, GL_FALSE,
+                stride, vertex_data.data() + 2));
+        GL_CALL(glEnableVertexAttribArray(tp.uvPosition));
+
+        enable(GL_BLEND);
+        blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        GL_CALL(glDrawArrays(GL_TRIANGLES, 0, vertex_data.size() / 4));
+
+        GL_CALL(glDisableVertexAttribArray(tp.uvPosition));
+        GL_CALL(glDisableVertexAttribArray(tp.position));
+    }
+
     void render_begin()
     {
         /* No real reason for 10, 10, 0 but it doesn't matter */
@@ -233,7 +556,8 @@ namespace OpenGL
 
         wlr_renderer_begin(wf::get_core_impl().renderer,
             viewport_width, viewport_height);
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
+        invalidate_state();
+        bind_framebuffer(GL_FRAMEBUFFER, fb);
     }
 
     void clear(wf_color col, uint32_t mask)
@@ -244,9 +568,10 @@ namespace OpenGL
 
     void render_end()
     {
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        bind_framebuffer(GL_FRAMEBUFFER, 0);
         wlr_renderer_scissor(wf::get_core().renderer, NULL);
         wlr_renderer_end(wf::get_core().renderer);
+        invalidate_state();
     }
 }
 
@@ -264,11 +589,11 @@ bool wf_framebuffer_base::allocate(int width, int height)
 
         first_allocate = true;
         GL_CALL(glGenTextures(1, &tex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        OpenGL::bind_texture(GL_TEXTURE_2D, tex);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        OpenGL::tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     }
 
     bool is_resize = false;
@@ -278,7 +603,7 @@ bool wf_framebuffer_base::allocate(int width, int height)
         if (first_allocate || width != viewport_width || height != viewport_height)
         {
             is_resize = true;
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+            OpenGL::bind_texture(GL_TEXTURE_2D, tex);
             GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
                     0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
         }
@@ -286,8 +611,8 @@ bool wf_framebuffer_base::allocate(int width, int height)
 
     if (first_allocate)
     {
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+        OpenGL::bind_framebuffer(GL_FRAMEBUFFER, fb);
+        OpenGL::bind_texture(GL_TEXTURE_2D, tex);
         GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                 GL_TEXTURE_2D, tex, 0));
     }
@@ -305,8 +630,8 @@ bool wf_framebuffer_base::allocate(int width, int height)
     viewport_width = width;
     viewport_height = height;
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    OpenGL::bind_texture(GL_TEXTURE_2D, 0);
+    OpenGL::bind_framebuffer(GL_FRAMEBUFFER, 0);
 
     return is_resize || first_allocate;
 }
@@ -340,13 +665,13 @@ wf_framebuffer_base& wf_framebuffer_base::operator = (wf_framebuffer_base&& othe
 
 void wf_framebuffer_base::bind() const
 {
-    GL_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb));
+    OpenGL::bind_framebuffer(GL_DRAW_FRAMEBUFFER, fb);
     GL_CALL(glViewport(0, 0, viewport_width, viewport_height));
 }
 
 void wf_framebuffer_base::scissor(wlr_box box) const
 {
-    GL_CALL(glEnable(GL_SCISSOR_TEST));
+    OpenGL::enable(GL_SCISSOR_TEST);
     GL_CALL(glScissor(box.x, viewport_height - box.y - box.height,
                       box.width, box.height));
 }
@@ -363,6 +688,8 @@ void wf_framebuffer_base::release()
         GL_CALL(glDeleteTextures(1, &tex));
     }
 
+    /* Deleted objects are unbound, and their names can be reused */
+    OpenGL::invalidate_state();
     reset();
 }
 
@@ -9,6 +9,8 @@
 #include "../output/output-impl.hpp"
 #include <xf86drmMode.h>
 #include <sstream>
+#include <cmath>
+#include <sys/stat.h>
 #include <unordered_set>
 
 extern "C"
@@ -18,6 +20,7 @@ extern "C"
 #include <wlr/backend/drm.h>
 #include <wlr/backend/noop.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output_management_v1.h>
@@ -489,31 +492,149 @@ namespace wf
         /* Mirroring implementation */
         wl_listener_wrapper on_mirrored_frame;
         wl_listener_wrapper on_frame;
+        wl_listener_wrapper on_mirror_damage_destroy;
+        wlr_output_damage *mirror_damage = nullptr;
+
+        /** A texture imported from one of the buffers of the mirrored output */
+        struct mirror_texture_t
+        {
+            dev_t dev;
+            ino_t ino;
+            wlr_dmabuf_attributes attributes;
+            wlr_texture *texture;
+        };
+
+        /* The mirrored output cycles through a few buffers, so we keep the
+         * last imported ones instead of importing each frame anew. */
+        static constexpr size_t MAX_MIRROR_TEXTURES = 4;
+        std::vector<mirror_texture_t> mirror_textures;
+
+        /* Damage on the mirrored output since the last mirrored frame,
+         * in buffer coordinates of the mirrored output */
+        wf_region source_damage;
+
+        /** @return The imported texture for the given dmabuf */
+        wlr_texture *get_mirror_texture(const wlr_dmabuf_attributes& attributes)
+        {
+            /* Each export dups the buffer fds, but they still refer to the
+             * same dmabuf file */
+            struct stat st;
+            if (fstat(attributes.fd[0], &st) < 0)
+                return nullptr;
+
+            for (auto& cached : mirror_textures)
+            {
+                auto& a = cached.attributes;
+                if (cached.dev == st.st_dev && cached.ino == st.st_ino &&
+                    a.width == attributes.width && a.height == attributes.height &&
+                    a.format == attributes.format && a.modifier == attributes.modifier &&
+                    a.n_planes == attributes.n_planes && a.flags == attributes.flags)
+                {
+                    return cached.texture;
+                }
+            }
+
+            auto texture = wlr_texture_from_dmabuf(
+                get_core().renderer, const_cast<wlr_dmabuf_attributes*> (&attributes));
+            if (!texture)
+                return nullptr;
+
+            if (mirror_textures.size() >= MAX_MIRROR_TEXTURES)
+            {
+                wlr_texture_destroy(mirror_textures.front().texture);
+                mirror_textures.erase(mirror_textures.begin());
+            }
+
+            mirror_textures.push_back({st.st_dev, st.st_ino, attributes, texture});
+            return texture;
+        }
+
+        void clear_mirror_textures()
+        {
+            for (auto& cached : mirror_textures)
+                wlr_texture_destroy(cached.texture);
+            mirror_textures.clear();
+        }
+
+        /**
+         * @return The box where the mirrored output is displayed, scaled to
+         * fit our output while keeping its aspect ratio
+         */
+        wlr_box get_mirror_geometry(int source_width, int source_height)
+        {
+            double scale = std::min(1.0 * handle->width / source_width,
+                1.0 * handle->height / source_height);
+
+            wlr_box geometry;
+            geometry.width = std::round(source_width * scale);
+            geometry.height = std::round(source_height * scale);
+            geometry.x = (handle->width - geometry.width) / 2;
+            geometry.y = (handle->height - geometry.height) / 2;
+            return geometry;
+        }
+
+        /** Damage the parts of our output which show the source damage */
+        void damage_from_source(int source_width, int source_height)
+        {
+            auto geometry = get_mirror_geometry(source_width, source_height);
+            double scale_x = 1.0 * geometry.width / source_width;
+            double scale_y = 1.0 * geometry.height / source_height;
+
+            wf_region damage;
+            for (const auto& rect : source_damage)
+            {
+                /* Grow by a pixel, so that filtering picks up the changes */
+                wlr_box box;
+                box.x = std::floor(rect.x1 * scale_x) + geometry.x - 1;
+                box.y = std::floor(rect.y1 * scale_y) + geometry.y - 1;
+                box.width = std::ceil(rect.x2 * scale_x) + geometry.x + 1 - box.x;
+                box.height = std::ceil(rect.y2 * scale_y) + geometry.y + 1 - box.y;
+                damage |= box;
+            }
+
+            wlr_output_damage_add(mirror_damage, damage.to_pixman());
+            source_damage.clear();
+        }
 
         /** Render the output using texture as source */
-        void render_output(wlr_texture *texture)
+        void render_output(wlr_texture *texture, wf_region& damage)
         {
             auto renderer = get_core().renderer;
-            wlr_output_attach_render(handle, NULL);
             wlr_renderer_begin(renderer, handle->width, handle->height);
 
-            /* Project a box filling the whole screen */
+            int source_width, source_height;
+            wlr_texture_get_size(texture, &source_width, &source_height);
+            auto geometry = get_mirror_geometry(source_width, source_height);
+
+            /* Project the mirrored output on our output */
             float projection[9], box[9];
             wlr_matrix_projection(projection, handle->width, handle->height,
                 WL_OUTPUT_TRANSFORM_NORMAL);
-
-            wlr_box geometry = {0, 0, handle->width, handle->height};
             wlr_matrix_project_box(box, &geometry, WL_OUTPUT_TRANSFORM_NORMAL,
                 0.0, projection);
 
-            wlr_render_texture_with_matrix(renderer, texture, box, 1.0);
+            static const float black[] = {0, 0, 0, 1};
+            for (const auto& rect : damage)
+            {
+                wlr_box scissor = wlr_box_from_pixman_box(rect);
+                wlr_renderer_scissor(renderer, &scissor);
+                wlr_renderer_clear(renderer, black);
+                wlr_render_texture_with_matrix(renderer, texture, box, 1.0);
+            }
+
+            wlr_renderer_scissor(renderer, NULL);
             wlr_renderer_end(renderer);
+
+            wlr_output_set_damage(handle, damage.to_pixman());
             wlr_output_commit(handle);
         }
 
         /* Load output contents and render them */
         void handle_frame()
         {
+            if (!mirror_damage)
+                return;
+
             auto wo = get_core().output_layout->find_output(
                 current_state.mirror_from);
             if (!wo)
@@ -530,14 +651,38 @@ namespace wf
                 return;
             }
 
+            damage_from_source(attributes.width, attributes.height);
+
+            bool needs_frame;
+            wf_region damage;
+            if (!wlr_output_damage_attach_render(mirror_damage, &needs_frame,
+                    damage.to_pixman()))
+            {
+                wlr_dmabuf_attributes_finish(&attributes);
+                return;
+            }
+
+            /* Nothing changed on the mirrored output since our last frame */
+            if (!needs_frame)
+            {
+                wlr_output_rollback(handle);
+                wlr_dmabuf_attributes_finish(&attributes);
+                return;
+            }
+
             /* We export the output to mirror from to a dmabuf, then create
              * a texture from this and use it to render "our" output */
-            auto texture = wlr_texture_from_dmabuf(
-                get_core().renderer, &attributes);
-            render_output(texture);
-
-            wlr_texture_destroy(texture);
+            auto texture = get_mirror_texture(attributes);
             wlr_dmabuf_attributes_finish(&attributes);
+
+            if (!texture)
+            {
+                log_error("Failed importing mirrored output contents");
+                wlr_output_rollback(handle);
+                return;
+            }
+
+            render_output(texture, damage);
         }
 
         void setup_mirror()
@@ -568,10 +713,30 @@ namespace wf
                 return;
             }
 
+            mirror_damage = wlr_output_damage_create(handle);
+            on_mirror_damage_destroy.set_callback([=] (void*) {
+                mirror_damage = nullptr;
+            });
+            on_mirror_damage_destroy.connect(&mirror_damage->events.destroy);
+            wlr_output_damage_add_whole(mirror_damage);
+
             wlr_output_schedule_frame(handle);
             on_mirrored_frame.set_callback([=] (void*) {
+                auto source = wo->handle;
+                if (!(source->pending.committed & WLR_OUTPUT_STATE_BUFFER))
+                    return;
+
                 /* The mirrored output was repainted, schedule repaint
                  * for us as well */
+                if (source->pending.committed & WLR_OUTPUT_STATE_DAMAGE)
+                {
+                    source_damage |= wf_region(&source->pending.damage);
+                } else
+                {
+                    source_damage |=
+                        wlr_box{0, 0, source->width, source->height};
+                }
+
                 wlr_output_schedule_frame(handle);
             });
             on_mirrored_frame.connect(&wo->handle->events.precommit);
@@ -584,6 +749,19 @@ namespace wf
         {
             on_mirrored_frame.disconnect();
             on_frame.disconnect();
+
+            on_mirror_damage_destroy.disconnect();
+            if (mirror_damage)
+                wlr_output_damage_destroy(mirror_damage);
+            mirror_damage = nullptr;
+
+            clear_mirror_textures();
+            source_damage.clear();
+        }
+
+        ~output_layout_output_t()
+        {
+            teardown_mirror();
         }
 
         /** Apply the given state to the output, ignoring position.
@@ -1,6 +1,7 @@
 #include "cursor.hpp"
 #include "touch.hpp"
 #include "../core-impl.hpp"
+#include "../trace.hpp"
 #include "input-manager.hpp"
 #include "workspace-manager.hpp"
 #include "debug.hpp"
@@ -10,6 +11,7 @@
 
 bool input_manager::handle_pointer_button(wlr_event_pointer_button *ev)
 {
+    WF_TRACE("input", "pointer button");
     mod_binding_key = 0;
 
     std::vector<std::function<void()>> callbacks;
@@ -90,7 +92,7 @@ void input_manager::update_cursor_focus(wf::surface_interface_t *focus, int x, i
         compositor_surface->on_pointer_leave();
 
     if (cursor_focus != focus)
-        log_info("change cursor focus %p -> %p", cursor_focus, focus);
+        log_debug_in("cursor", "change cursor focus %p -> %p", cursor_focus, focus);
 
     cursor_focus = focus;
     if (focus && !wf_compositor_surface_from_surface(focus))
@@ -157,6 +159,7 @@ void input_manager::update_cursor_position(uint32_t time_msec, bool real_update)
 
 void input_manager::handle_pointer_motion(wlr_event_pointer_motion *ev)
 {
+    WF_TRACE("input", "pointer motion");
     if (input_grabbed() && active_grab->callbacks.pointer.relative_motion)
         active_grab->callbacks.pointer.relative_motion(ev);
 
@@ -166,12 +169,14 @@ void input_manager::handle_pointer_motion(wlr_event_pointer_motion *ev)
 
 void input_manager::handle_pointer_motion_absolute(wlr_event_pointer_motion_absolute *ev)
 {
+    WF_TRACE("input", "pointer motion");
     wlr_cursor_warp_absolute(cursor->cursor, ev->device, ev->x, ev->y);
     update_cursor_position(ev->time_msec);
 }
 
 void input_manager::handle_pointer_axis(wlr_event_pointer_axis *ev)
 {
+    WF_TRACE("input", "pointer axis");
     std::vector<axis_callback*> callbacks;
 
     auto mod_state = get_modifiers();
@@ -283,7 +288,9 @@ void wf_cursor::setup_listeners()
     auto& core = wf::get_core_impl();
 
     on_button.set_callback([&] (void *data) {
-        this->handle_pointer_button((wlr_event_pointer_button*) data);
+        auto ev = static_cast<wlr_event_pointer_button*> (data);
+        core.input->latency.input_received(ev->device);
+        this->handle_pointer_button(ev);
         wlr_idle_notify_activity(core.protocols.idle, core.get_current_seat());
     });
     on_button.connect(&cursor->events.button);
@@ -299,6 +306,7 @@ void wf_cursor::setup_listeners()
 #define setup_passthrough_callback(evname) \
     on_##evname.set_callback([&] (void *data) { \
         auto ev = static_cast<wlr_event_pointer_##evname *> (data); \
+        core.input->latency.input_received(ev->device); \
         core.input->handle_pointer_##evname (ev); \
         wlr_idle_notify_activity(core.protocols.idle, core.get_current_seat()); \
     }); \
@@ -0,0 +1,101 @@
+#include "input-latency.hpp"
+#include "debug.hpp"
+#include <algorithm>
+#include <ctime>
+
+/* Events which didn't cause a frame for this long most probably didn't
+ * change anything on the screen, so they are not counted at all */
+static constexpr int64_t MAX_EVENT_AGE = 1000000;
+static constexpr size_t MAX_EVENTS = 4096;
+
+int64_t input_latency_tracker_t::get_time_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+void input_latency_tracker_t::input_received(wlr_input_device *device)
+{
+    int64_t now = get_time_us();
+    while (!events.empty() && (events.size() >= MAX_EVENTS ||
+            now - events.front().time > MAX_EVENT_AGE))
+    {
+        events.pop_front();
+    }
+
+    events.push_back({++last_id, now, device, false});
+}
+
+void input_latency_tracker_t::frame_committed(uint64_t& last_seen,
+    int64_t repaint_start, wf::latency_histogram_t& output_latency)
+{
+    int64_t now = get_time_us();
+    for (auto& event : events)
+    {
+        if (event.id <= last_seen)
+            continue;
+
+        /* Arrived during the repaint, will be shown in the next frame */
+        if (event.time > repaint_start)
+            break;
+
+        last_seen = event.id;
+        if (now - event.time > MAX_EVENT_AGE)
+            continue;
+
+        output_latency.add(now - event.time);
+        if (!event.shown && event.device)
+            device_latency[event.device].add(now - event.time);
+        event.shown = true;
+    }
+}
+
+void input_latency_tracker_t::frame_skipped(uint64_t& last_seen,
+    int64_t repaint_start)
+{
+    for (auto& event : events)
+    {
+        if (event.time > repaint_start)
+            break;
+
+        last_seen = std::max(last_seen, event.id);
+    }
+}
+
+uint64_t input_latency_tracker_t::get_last_event() const
+{
+    return last_id;
+}
+
+wf::latency_histogram_t input_latency_tracker_t::get_device_latency(
+    wlr_input_device *device) const
+{
+    auto it = device_latency.find(device);
+    if (it == device_latency.end())
+        return {};
+
+    return it->second;
+}
+
+void input_latency_tracker_t::device_removed(wlr_input_device *device)
+{
+    for (auto& event : events)
+    {
+        if (event.device == device)
+            event.device = nullptr;
+    }
+
+    auto it = device_latency.find(device);
+    if (it == device_latency.end())
+        return;
+
+    auto& latency = it->second;
+    log_info("input latency of %s: %lu events, avg %.2fms, p50 %dms, "
+        "p99 %dms, max %.2fms", nonull(device->name),
+        (unsigned long)latency.count, latency.get_average(),
+        latency.get_percentile(50), latency.get_percentile(99),
+        latency.max_us / 1000.0);
+
+    device_latency.erase(it);
+}
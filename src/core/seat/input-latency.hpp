@@ -0,0 +1,74 @@
+#ifndef WF_INPUT_LATENCY_HPP
+#define WF_INPUT_LATENCY_HPP
+
+#include <map>
+#include <deque>
+#include "util.hpp"
+
+extern "C"
+{
+#include <wlr/types/wlr_input_device.h>
+}
+
+/**
+ * Measures the latency from input events to the first frame which could
+ * reflect them.
+ *
+ * Each event is stamped when it enters the compositor. When an output
+ * commits a frame, all events which arrived before the start of its repaint
+ * and which the output hasn't seen yet are counted as shown in that frame.
+ * Latencies are collected per output (by the render manager) and per device,
+ * where a device event counts only for the first output which shows it.
+ */
+class input_latency_tracker_t
+{
+  public:
+    /** Stamp an input event from the given device */
+    void input_received(wlr_input_device *device);
+
+    /**
+     * Account the events shown by a frame which was just committed.
+     *
+     * @param last_seen The id of the last event already seen by the output,
+     *        it is updated to the last event shown in this frame.
+     * @param repaint_start The time the repaint started, in microseconds.
+     * @param output_latency The histogram of the output.
+     */
+    void frame_committed(uint64_t& last_seen, int64_t repaint_start,
+        wf::latency_histogram_t& output_latency);
+
+    /**
+     * Mark the events before a repaint which didn't commit a frame as seen,
+     * without measuring them. They didn't change anything on the output, so
+     * a later, unrelated frame must not be blamed for them.
+     *
+     * @param last_seen The id of the last event already seen by the output,
+     *        it is updated to the last event before repaint_start.
+     * @param repaint_start The time the repaint started, in microseconds.
+     */
+    void frame_skipped(uint64_t& last_seen, int64_t repaint_start);
+
+    /** @return The id of the last event, used to initialize new outputs */
+    uint64_t get_last_event() const;
+
+    wf::latency_histogram_t get_device_latency(wlr_input_device *device) const;
+    void device_removed(wlr_input_device *device);
+
+    /** @return The current time in microseconds, on CLOCK_MONOTONIC */
+    static int64_t get_time_us();
+
+  private:
+    struct event_t
+    {
+        uint64_t id;
+        int64_t time;
+        wlr_input_device *device;
+        bool shown;
+    };
+
+    std::deque<event_t> events;
+    uint64_t last_id = 0;
+    std::map<wlr_input_device*, wf::latency_histogram_t> device_latency;
+};
+
+#endif /* end of include guard: WF_INPUT_LATENCY_HPP */
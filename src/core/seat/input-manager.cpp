@@ -13,6 +13,8 @@ extern "C"
 #include "keyboard.hpp"
 #include "cursor.hpp"
 #include "input-manager.hpp"
+#include "seat.hpp"
+#include "render-manager.hpp"
 #include "output-layout.hpp"
 #include "workspace-manager.hpp"
 #include "debug.hpp"
@@ -76,6 +78,7 @@ void input_manager::handle_new_input(wlr_input_device *dev)
 void input_manager::handle_input_destroyed(wlr_input_device *dev)
 {
     log_info("remove input: %s", dev->name);
+    latency.device_removed(dev);
 
     auto it = std::remove_if(input_devices.begin(), input_devices.end(),
         [=] (const std::unique_ptr<wf_input_device_internal>& idev) {
@@ -260,7 +263,8 @@ wf::surface_interface_t* input_manager::input_surface_at(int x, int y,
     {
         if (can_focus_surface(view.get()))
         {
-            auto surface = view->map_input_coordinates(x, y, lx, ly);
+            auto point = get_viewport_point(view.get(), {x, y});
+            auto surface = view->map_input_coordinates(point.x, point.y, lx, ly);
             if (surface)
                 return surface;
         }
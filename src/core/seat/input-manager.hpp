@@ -7,6 +7,7 @@
 
 #include "seat.hpp"
 #include "cursor.hpp"
+#include "input-latency.hpp"
 #include "plugin.hpp"
 #include "view.hpp"
 
@@ -122,6 +123,8 @@ class input_manager
         std::vector<std::unique_ptr<wf_keyboard>> keyboards;
         std::vector<std::unique_ptr<wf_input_device_internal>> input_devices;
 
+        input_latency_tracker_t latency;
+
         void set_keyboard_focus(wayfire_view view, wlr_seat *seat);
 
         bool grab_input(wf::plugin_grab_interface_t*);
@@ -9,6 +9,7 @@ extern "C"
 
 #include "keyboard.hpp"
 #include "../core-impl.hpp"
+#include "../trace.hpp"
 #include "cursor.hpp"
 #include "touch.hpp"
 #include "input-manager.hpp"
@@ -20,6 +21,7 @@ void wf_keyboard::setup_listeners()
     on_key.set_callback([&] (void *data)
     {
         auto ev = static_cast<wlr_event_keyboard_key*> (data);
+        wf::get_core_impl().input->latency.input_received(this->device);
 
         auto seat = wf::get_core().get_current_seat();
         wlr_seat_set_keyboard(seat, this->device);
@@ -208,6 +210,7 @@ std::vector<std::function<void()>> input_manager::match_keys(uint32_t mod_state,
 
 bool input_manager::handle_keyboard_key(uint32_t key, uint32_t state)
 {
+    WF_TRACE("input", "keyboard key");
     using namespace std::chrono;
 
     if (active_grab && active_grab->callbacks.keyboard.key)
@@ -184,6 +184,11 @@ namespace wf
         return mode == LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
     }
 
+    latency_histogram_t input_device_t::get_input_latency()
+    {
+        return wf::get_core_impl().input->latency.get_device_latency(handle);
+    }
+
     input_device_t::input_device_t(wlr_input_device *handle)
     {
         this->handle = handle;
@@ -314,11 +319,21 @@ void wf_input_device_internal::update_options()
     }
 }
 
+wf_point get_viewport_point(wf::view_interface_t *view, wf_point point)
+{
+    /* Shell views aren't scrolled with the viewport */
+    if (!view->get_output() || view->role == wf::VIEW_ROLE_SHELL_VIEW)
+        return point;
+
+    return point + view->get_output()->render->get_viewport_offset();
+}
+
 wf_point get_surface_relative_coords(wf::surface_interface_t *surface,
     const wf_point& point)
 {
     auto view =
         dynamic_cast<wf::view_interface_t*> (surface->get_main_surface());
-    auto local = view->global_to_local_point(point, surface);
+    auto local = view->global_to_local_point(
+        get_viewport_point(view, point), surface);
     return local;
 }
@@ -52,6 +52,13 @@ class wf_input_device_internal : public wf::input_device_t
     } config;
 };
 
+/**
+ * Convert an output-local point to the coordinates of the view's workspace
+ * position, taking the viewport offset of the output into account. See
+ * render_manager::set_viewport_offset().
+ */
+wf_point get_viewport_point(wf::view_interface_t *view, wf_point point);
+
 /** Convert the given point to a surface-local point */
 wf_point get_surface_relative_coords(wf::surface_interface_t *surface,
     const wf_point& point);
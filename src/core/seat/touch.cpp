@@ -4,6 +4,7 @@
 #include "touch.hpp"
 #include "input-manager.hpp"
 #include "../core-impl.hpp"
+#include "../trace.hpp"
 #include "output.hpp"
 #include "workspace-manager.hpp"
 #include "compositor-surface.hpp"
@@ -230,6 +231,7 @@ wf_touch::wf_touch(wlr_cursor *cursor)
     on_down.set_callback([&] (void *data)
     {
         auto ev = static_cast<wlr_event_touch_down*> (data);
+        wf::get_core_impl().input->latency.input_received(ev->device);
 
         double lx, ly;
         wlr_cursor_absolute_to_layout_coords(wf::get_core_impl().input->cursor->cursor,
@@ -246,6 +248,7 @@ wf_touch::wf_touch(wlr_cursor *cursor)
     on_up.set_callback([&] (void *data)
     {
         auto ev = static_cast<wlr_event_touch_up*> (data);
+        wf::get_core_impl().input->latency.input_received(ev->device);
         gesture_recognizer.unregister_touch(ev->time_msec, ev->touch_id);
 
         wlr_idle_notify_activity(wf::get_core().protocols.idle,
@@ -255,6 +258,7 @@ wf_touch::wf_touch(wlr_cursor *cursor)
     on_motion.set_callback([&] (void *data)
     {
         auto ev = static_cast<wlr_event_touch_motion*> (data);
+        wf::get_core_impl().input->latency.input_received(ev->device);
         auto touch = static_cast<wf_touch*> (ev->device->data);
 
         double lx, ly;
@@ -339,6 +343,7 @@ void input_manager::set_touch_focus(wf::surface_interface_t *surface,
 void input_manager::handle_touch_down(uint32_t time, int32_t id,
     int32_t x, int32_t y)
 {
+    WF_TRACE("input", "touch down");
     mod_binding_key = 0;
     ++our_touch->count_touch_down;
     if (our_touch->count_touch_down == 1)
@@ -384,6 +389,7 @@ void input_manager::handle_touch_down(uint32_t time, int32_t id,
 
 void input_manager::handle_touch_up(uint32_t time, int32_t id)
 {
+    WF_TRACE("input", "touch up");
     --our_touch->count_touch_down;
     if (active_grab)
     {
@@ -399,6 +405,7 @@ void input_manager::handle_touch_up(uint32_t time, int32_t id)
 void input_manager::handle_touch_motion(uint32_t time, int32_t id,
     int32_t x, int32_t y)
 {
+    WF_TRACE("input", "touch motion");
     if (active_grab)
     {
         auto wo = wf::get_core().output_layout->get_output_at(x, y);
@@ -0,0 +1,196 @@
+#include "trace.hpp"
+#include "debug.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace wf
+{
+namespace trace
+{
+namespace
+{
+constexpr int RING_SIZE = 16384;
+constexpr int MAX_DETAIL = 40;
+
+struct event_t
+{
+    const char *category;
+    const char *name;
+    char detail[MAX_DETAIL];
+    int64_t start;
+    int64_t duration;
+    pid_t tid;
+};
+
+/**
+ * Events of a single thread. The lock is taken only by the owning thread
+ * and by dump(), so it is practically never contended.
+ */
+struct ring_buffer_t
+{
+    std::mutex lock;
+    std::vector<event_t> events = std::vector<event_t> (RING_SIZE);
+    uint64_t written = 0;
+};
+
+/**
+ * All ring buffers ever allocated. Rings of threads which have exited are
+ * put in the free list and reused by new threads, so that short-lived
+ * worker threads don't leak memory. Their events remain until overwritten.
+ */
+struct registry_t
+{
+    std::mutex lock;
+    std::vector<std::unique_ptr<ring_buffer_t>> rings;
+    std::vector<ring_buffer_t*> free_rings;
+
+    ring_buffer_t *acquire()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!free_rings.empty())
+        {
+            auto ring = free_rings.back();
+            free_rings.pop_back();
+            return ring;
+        }
+
+        rings.push_back(std::make_unique<ring_buffer_t> ());
+        return rings.back().get();
+    }
+
+    void release(ring_buffer_t *ring)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        free_rings.push_back(ring);
+    }
+};
+
+/* Never destroyed, so that threads exiting after main() can still
+ * release their rings */
+registry_t& get_registry()
+{
+    static auto registry = new registry_t;
+    return *registry;
+}
+
+struct thread_ring_t
+{
+    ring_buffer_t *ring = get_registry().acquire();
+    pid_t tid = syscall(SYS_gettid);
+
+    ~thread_ring_t()
+    {
+        get_registry().release(ring);
+    }
+};
+
+thread_local thread_ring_t thread_ring;
+
+void write_escaped(FILE *file, const char *str)
+{
+    for (; *str; ++str)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+        {
+            std::fprintf(file, "\\%c", c);
+        } else if (c < 0x20)
+        {
+            std::fprintf(file, "\\u%04x", c);
+        } else
+        {
+            std::fputc(c, file);
+        }
+    }
+}
+}
+
+int64_t get_time_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+}
+
+void record(const char *category, const char *name, const char *detail,
+    int64_t start_us, int64_t duration_us)
+{
+    auto& local = thread_ring;
+    auto& ring = *local.ring;
+
+    std::lock_guard<std::mutex> guard(ring.lock);
+    auto& event = ring.events[ring.written % RING_SIZE];
+    ++ring.written;
+
+    event.category = category;
+    event.name = name;
+    event.start = start_us;
+    event.duration = duration_us;
+    event.tid = local.tid;
+    std::strncpy(event.detail, detail ? detail : "", MAX_DETAIL - 1);
+    event.detail[MAX_DETAIL - 1] = '\0';
+}
+
+bool dump(const std::string& file_name)
+{
+    /* Copy the events first, so that the threads are blocked only briefly */
+    std::vector<event_t> events;
+    {
+        auto& registry = get_registry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        for (auto& ring : registry.rings)
+        {
+            std::lock_guard<std::mutex> ring_guard(ring->lock);
+            uint64_t count = std::min<uint64_t> (ring->written, RING_SIZE);
+            for (uint64_t i = ring->written - count; i < ring->written; i++)
+                events.push_back(ring->events[i % RING_SIZE]);
+        }
+    }
+
+    FILE *file = std::fopen(file_name.c_str(), "w");
+    if (!file)
+    {
+        log_error("failed to open trace file %s", file_name.c_str());
+        return false;
+    }
+
+    std::sort(events.begin(), events.end(),
+        [] (const event_t& a, const event_t& b) { return a.start < b.start; });
+
+    pid_t pid = getpid();
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        auto& event = events[i];
+        std::fprintf(file, "%s\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+            "\"ts\":%lld,\"dur\":%lld,\"cat\":\"%s\",\"name\":\"%s\"",
+            i ? "," : "", (int)pid, (int)event.tid, (long long)event.start,
+            (long long)event.duration, event.category, event.name);
+
+        if (event.detail[0])
+        {
+            std::fputs(",\"args\":{\"detail\":\"", file);
+            write_escaped(file, event.detail);
+            std::fputs("\"}", file);
+        }
+
+        std::fputc('}', file);
+    }
+
+    std::fputs("\n]}\n", file);
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+
+    log_info("wrote %zu trace events to %s", events.size(), file_name.c_str());
+    return ok;
+}
+}
+}
@@ -0,0 +1,97 @@
+#ifndef WF_TRACE_HPP
+#define WF_TRACE_HPP
+
+#include "config.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * Lightweight tracing of compositor events.
+ *
+ * Trace points record their start time and duration into a ring buffer of
+ * the thread they run on, so the last few thousand events of each thread
+ * are always available. The buffers can be dumped at any time in the
+ * Chrome trace format, which can be loaded in chrome://tracing or Perfetto.
+ *
+ * Tracing is enabled with the enable_tracing build option, which is off
+ * by default. Without it, the trace macros expand to nothing.
+ */
+namespace wf
+{
+namespace trace
+{
+/** @return The current time in microseconds, on the CLOCK_MONOTONIC clock */
+int64_t get_time_us();
+
+/**
+ * Record a finished event in the ring buffer of the current thread.
+ *
+ * @param category The category of the event, must be a string literal.
+ * @param name The name of the event, must be a string literal.
+ * @param detail Optional details for the event, copied and truncated.
+ */
+void record(const char *category, const char *name, const char *detail,
+    int64_t start_us, int64_t duration_us);
+
+/**
+ * Write all recorded events to the given file, in the Chrome trace JSON
+ * format.
+ *
+ * @return true on success
+ */
+bool dump(const std::string& file_name);
+
+/**
+ * Records an event for the lifetime of the object.
+ *
+ * The detail isn't copied until the event is recorded, so it must outlive
+ * the object.
+ */
+class scoped_trace_t
+{
+    const char *category, *name, *detail = nullptr;
+    int64_t start;
+
+  public:
+    scoped_trace_t(const char *category, const char *name)
+        : category(category), name(name), start(get_time_us()) { }
+
+    scoped_trace_t(const char *category, const char *name, const char *detail)
+        : category(category), name(name), detail(detail),
+        start(get_time_us()) { }
+
+    scoped_trace_t(const char *category, const char *name,
+        const std::string& detail)
+        : scoped_trace_t(category, name, detail.c_str()) { }
+
+    /* The temporary would be gone before the event is recorded */
+    scoped_trace_t(const char *category, const char *name,
+        std::string&& detail) = delete;
+
+    ~scoped_trace_t()
+    {
+        record(category, name, detail, start, get_time_us() - start);
+    }
+
+    scoped_trace_t(const scoped_trace_t&) = delete;
+    scoped_trace_t& operator = (const scoped_trace_t&) = delete;
+};
+}
+}
+
+#define WF_TRACE_CONCAT_IMPL(a, b) a ## b
+#define WF_TRACE_CONCAT(a, b) WF_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef WAYFIRE_TRACING_ENABLED
+/* Trace the rest of the enclosing scope */
+#define WF_TRACE(category, name) \
+    wf::trace::scoped_trace_t WF_TRACE_CONCAT(_wf_trace_, __LINE__) (category, name)
+/* Same as WF_TRACE, with a dynamic detail string */
+#define WF_TRACE_DETAIL(category, name, detail) \
+    wf::trace::scoped_trace_t WF_TRACE_CONCAT(_wf_trace_, __LINE__) (category, name, detail)
+#else
+#define WF_TRACE(category, name)
+#define WF_TRACE_DETAIL(category, name, detail)
+#endif
+
+#endif /* end of include guard: WF_TRACE_HPP */
@@ -0,0 +1,235 @@
+#include "transaction.hpp"
+#include "view-transform.hpp"
+#include "signal-definitions.hpp"
+#include "render-manager.hpp"
+#include "output.hpp"
+#include "opengl.hpp"
+#include "debug.hpp"
+#include "core.hpp"
+#include "../view/view-impl.hpp"
+
+#include <map>
+#include <set>
+
+/**
+ * Shows a snapshot of the view, taken when the transformer was created,
+ * instead of its current contents.
+ */
+class frozen_view_transformer_t : public wf_view_transformer_t
+{
+    wayfire_view view;
+    wf_framebuffer snapshot;
+    wf_geometry frozen_wm;
+
+  public:
+    frozen_view_transformer_t(wayfire_view view)
+    {
+        this->view = view;
+        frozen_wm = view->get_wm_geometry();
+        view->render_snapshot(snapshot);
+    }
+
+    ~frozen_view_transformer_t()
+    {
+        OpenGL::render_begin();
+        snapshot.release();
+        OpenGL::render_end();
+    }
+
+    /* The snapshot already contains the other transformers */
+    uint32_t get_z_order() override { return WF_TRANSFORMER_BLUR + 1; }
+
+    wf_point local_to_transformed_point(wf_geometry, wf_point point) override
+    {
+        auto wm = view->get_wm_geometry();
+        return {point.x + frozen_wm.x - wm.x, point.y + frozen_wm.y - wm.y};
+    }
+
+    wf_point transformed_to_local_point(wf_geometry, wf_point point) override
+    {
+        auto wm = view->get_wm_geometry();
+        return {point.x - frozen_wm.x + wm.x, point.y - frozen_wm.y + wm.y};
+    }
+
+    wlr_box get_bounding_box(wf_geometry, wlr_box) override
+    {
+        return snapshot.geometry;
+    }
+
+    void render_box(uint32_t, wlr_box, wlr_box scissor_box,
+        const wf_framebuffer& target_fb) override
+    {
+        auto& g = snapshot.geometry;
+        gl_geometry geometry = {1.0f * g.x, 1.0f * g.y,
+            1.0f * (g.x + g.width), 1.0f * (g.y + g.height)};
+
+        OpenGL::render_begin(target_fb);
+        target_fb.scissor(scissor_box);
+        OpenGL::render_transformed_texture(snapshot.tex, geometry, {},
+            target_fb.get_orthographic_projection());
+        OpenGL::render_end();
+    }
+};
+
+namespace
+{
+struct view_change_t
+{
+    bool has_geometry = false;
+    wf_geometry geometry;
+
+    /* -1 if unchanged */
+    int maximized = -1;
+};
+
+/**
+ * A committed transaction waiting for its clients. It deletes itself once
+ * all views have been unfrozen.
+ */
+class pending_transaction_t
+{
+    std::map<wayfire_view, nonstd::observer_ptr<wf_view_transformer_t>> frozen;
+    std::set<wayfire_view> waiting;
+
+    wf::wl_timer timeout;
+    wf::signal_callback_t on_resize_done, on_unmap;
+    bool done = false;
+
+    void unfreeze(wayfire_view view)
+    {
+        view->disconnect_signal("resize-done", &on_resize_done);
+        view->disconnect_signal("unmap", &on_unmap);
+        if (view->get_output())
+            view->pop_transformer(frozen[view]);
+        view->unref();
+    }
+
+    void check_done()
+    {
+        if (done || !waiting.empty())
+            return;
+
+        done = true;
+        timeout.disconnect();
+        for (auto& view : frozen)
+            unfreeze(view.first);
+        frozen.clear();
+
+        /* We may be inside one of our own callbacks */
+        wl_event_loop_add_idle(wf::get_core().ev_loop, [] (void *data) {
+            delete (pending_transaction_t*) data;
+        }, this);
+    }
+
+  public:
+    pending_transaction_t(const std::map<wayfire_view, view_change_t>& changes,
+        uint32_t timeout_ms)
+    {
+        on_resize_done = [=] (wf::signal_data_t *data)
+        {
+            waiting.erase(get_signaled_view(data));
+            check_done();
+        };
+
+        on_unmap = [=] (wf::signal_data_t *data)
+        {
+            auto view = get_signaled_view(data);
+            waiting.erase(view);
+            unfreeze(view);
+            frozen.erase(view);
+            check_done();
+        };
+
+        /* Take all snapshots first, so that they show the old layout */
+        for (auto& change : changes)
+        {
+            auto view = change.first;
+            if (!view->is_mapped() || !view->get_output())
+                continue;
+
+            auto tr = new frozen_view_transformer_t(view);
+            frozen[view] = nonstd::make_observer(tr);
+            view->add_transformer(std::unique_ptr<wf_view_transformer_t>(tr),
+                "transaction");
+
+            view->take_ref();
+            view->connect_signal("resize-done", &on_resize_done);
+            view->connect_signal("unmap", &on_unmap);
+        }
+
+        for (auto& change : changes)
+        {
+            auto view = change.first;
+            if (!view->view_impl->is_alive)
+                continue;
+
+            if (change.second.maximized >= 0)
+                view->set_maximized(change.second.maximized);
+            if (change.second.has_geometry)
+                view->set_geometry(change.second.geometry);
+
+            if (frozen.count(view) && view->has_pending_resize())
+                waiting.insert(view);
+        }
+
+        timeout.set_timeout(timeout_ms, [=] ()
+        {
+            log_debug("transaction timed out waiting for %lu views",
+                (unsigned long)waiting.size());
+            waiting.clear();
+            check_done();
+        });
+
+        check_done();
+    }
+};
+}
+
+class wf::transaction_t::impl
+{
+  public:
+    uint32_t timeout;
+    std::map<wayfire_view, view_change_t> changes;
+
+    /* Keep the views alive until the transaction is committed */
+    view_change_t& get_change(wayfire_view view)
+    {
+        if (!changes.count(view))
+            view->take_ref();
+        return changes[view];
+    }
+};
+
+wf::transaction_t::transaction_t(uint32_t timeout)
+    : pimpl(new impl())
+{
+    pimpl->timeout = timeout;
+}
+
+wf::transaction_t::~transaction_t()
+{
+    commit();
+}
+
+void wf::transaction_t::set_geometry(wayfire_view view, wf_geometry geometry)
+{
+    auto& change = pimpl->get_change(view);
+    change.has_geometry = true;
+    change.geometry = geometry;
+}
+
+void wf::transaction_t::set_maximized(wayfire_view view, bool maximized)
+{
+    pimpl->get_change(view).maximized = maximized;
+}
+
+void wf::transaction_t::commit()
+{
+    if (pimpl->changes.empty())
+        return;
+
+    new pending_transaction_t(pimpl->changes, pimpl->timeout);
+    for (auto& change : pimpl->changes)
+        change.first->unref();
+    pimpl->changes.clear();
+}
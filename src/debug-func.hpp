@@ -69,6 +69,7 @@ void wf_print_trace()
 void signalHandle(int sig) {
     log_error ("crash detected!");
     wf_print_trace();
+    wf::log::stop();
     raise(SIGTRAP);
 }
 
@@ -84,4 +85,4 @@ const char *wf_strip_path(const char *filepath)
         }
     }
     return filepath;
-}                                                                                                                                               
+}                                                                                                                                               
@@ -24,6 +24,7 @@ extern "C"
 #include <wayland-server.h>
 
 #include "core/core-impl.hpp"
+#include "core/trace.hpp"
 #include "view/view-impl.hpp"
 #include "output.hpp"
 
@@ -32,11 +33,21 @@ wf_runtime_config runtime_config;
 #define INOT_BUF_SIZE (1024 * sizeof(inotify_event))
 char buf[INOT_BUF_SIZE];
 
+#ifdef WAYFIRE_DEBUG_ENABLED
+static const wlr_log_importance default_verbosity = WLR_DEBUG;
+#else
+static const wlr_log_importance default_verbosity = WLR_ERROR;
+#endif
+
 static std::string config_file;
 static void reload_config(int fd)
 {
-    wf::get_core().config->reload_config();
+    auto config = wf::get_core().config;
+    config->reload_config();
     inotify_add_watch(fd, config_file.c_str(), IN_MODIFY);
+
+    auto log_levels = config->get_section("core")->get_option("log_levels", "");
+    wf::log::set_verbosity(default_verbosity, log_levels->as_string());
 }
 
 static int handle_config_updated(int fd, uint32_t mask, void *data)
@@ -51,6 +62,19 @@ static int handle_config_updated(int fd, uint32_t mask, void *data)
     return 1;
 }
 
+#ifdef WAYFIRE_TRACING_ENABLED
+static int handle_trace_dump(int signal, void *data)
+{
+    std::string dir = nonull(getenv("XDG_RUNTIME_DIR"));
+    if (dir == "nil")
+        dir = "/tmp";
+
+    wf::trace::dump(dir + "/wayfire-trace-" + std::to_string(getpid()) + "-" +
+        std::to_string(get_current_time()) + ".json");
+    return 0;
+}
+#endif
+
 std::map<EGLint, EGLint> default_attribs = {
     {EGL_RED_SIZE, 1},
     {EGL_GREEN_SIZE, 1},
@@ -139,11 +163,8 @@ int main(int argc, char *argv[])
     signal(SIGABRT, signalHandle);
     */
 
-#ifdef WAYFIRE_DEBUG_ENABLED
-    wlr_log_init(WLR_DEBUG, NULL);
-#else
-    wlr_log_init(WLR_ERROR, NULL);
-#endif
+    wf::log::set_verbosity(default_verbosity);
+    wf::log::start();
 
     std::string config_dir = nonull(getenv("XDG_CONFIG_DIR"));
     if (!config_dir.compare("nil"))
@@ -201,12 +222,16 @@ int main(int argc, char *argv[])
 
     wl_event_loop_add_fd(core.ev_loop, inotify_fd, WL_EVENT_READABLE,
         handle_config_updated, NULL);
+#ifdef WAYFIRE_TRACING_ENABLED
+    wl_event_loop_add_signal(core.ev_loop, SIGUSR2, handle_trace_dump, NULL);
+#endif
     core.init(core.config);
 
     auto server_name = wl_display_add_socket_auto(core.display);
     if (!server_name)
     {
         log_error("failed to create wayland, socket, exiting");
+        wf::log::stop();
         return -1;
     }
 
@@ -218,6 +243,7 @@ int main(int argc, char *argv[])
         log_error("failed to initialize backend, exiting");
         wlr_backend_destroy(core.backend);
         wl_display_destroy(core.display);
+        wf::log::stop();
         return -1;
     }
 
@@ -230,6 +256,7 @@ int main(int argc, char *argv[])
     /* Teardown */
     wl_display_destroy_clients(core.display);
     wl_display_destroy(core.display);
+    wf::log::stop();
 
     return EXIT_SUCCESS;
 }
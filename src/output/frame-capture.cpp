@@ -0,0 +1,368 @@
+#include "frame-capture.hpp"
+#include "render-manager.hpp"
+#include "opengl.hpp"
+#include "debug.hpp"
+
+#include <cstring>
+#include <deque>
+#include <algorithm>
+
+namespace wf
+{
+class frame_capture_t::impl
+{
+  public:
+    struct request_t
+    {
+        callback_t callback;
+        bool damage_only;
+    };
+
+    /** A pixel buffer object and the readback which uses it */
+    struct readback_slot_t
+    {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        bool in_flight = false;
+
+        /* The box which was read, in framebuffer coordinates */
+        wlr_box box;
+        int frame_width, frame_height;
+        callback_t callback;
+    };
+
+    output_t *output;
+    std::vector<readback_slot_t> slots;
+    /* Indices of the slots in flight, oldest first */
+    std::deque<int> in_flight;
+    std::deque<request_t> requests;
+
+    post_hook_t hook;
+    effect_hook_t poll_hook;
+    /* The hooks are installed only while there is something to capture,
+     * because a post hook makes the output repaint fully, through an
+     * offscreen buffer, and disables direct scanout */
+    bool hooks_installed = false;
+
+    /* The source of the last post hook invocation. It keeps the last frame
+     * until the next repaint, so captures can be done without repainting */
+    uint32_t last_source_fb;
+    int last_width = 0, last_height = 0;
+
+    /* Damage since the last readback, in damage coordinates */
+    wf_region accumulated_damage;
+    /* The result of the last capture, base for damage-only captures */
+    std::shared_ptr<image_io::image_t> last_frame;
+
+    stream_callback_t stream_callback;
+    /* Incremented on each start/stop, so that readbacks for an old stream
+     * can be recognized */
+    uint32_t stream_id = 0;
+    uint32_t dropped_frames = 0;
+
+    impl(output_t *output, int ring_size)
+    {
+        this->output = output;
+        slots.resize(std::max(ring_size, 1));
+
+        hook = [=] (const wf_framebuffer_base& source,
+            const wf_framebuffer_base& destination)
+        {
+            pass_through(source, destination);
+        };
+
+        poll_hook = [=] () { poll(); };
+    }
+
+    ~impl()
+    {
+        if (hooks_installed)
+        {
+            output->render->rem_post(&hook);
+            output->render->rem_effect(&poll_hook);
+        }
+
+        OpenGL::render_begin();
+        for (auto& slot : slots)
+        {
+            if (slot.fence)
+            {
+                GL_CALL(glDeleteSync(slot.fence));
+            }
+
+            if (slot.pbo)
+            {
+                GL_CALL(glDeleteBuffers(1, &slot.pbo));
+            }
+        }
+        OpenGL::render_end();
+    }
+
+    /** Install or remove the hooks, depending on whether there are
+     * pending captures */
+    void update_hooks()
+    {
+        bool active = stream_callback || !requests.empty() ||
+            !in_flight.empty();
+
+        if (active && !hooks_installed)
+        {
+            output->render->add_post(&hook);
+            output->render->add_effect(&poll_hook, OUTPUT_EFFECT_POST);
+            hooks_installed = true;
+
+            /* The last source buffer is gone and the damage since then is
+             * unknown, so start with a full frame */
+            last_width = last_height = 0;
+            output->render->damage_whole();
+        } else if (!active && hooks_installed)
+        {
+            output->render->rem_post(&hook);
+            output->render->rem_effect(&poll_hook);
+            hooks_installed = false;
+        }
+    }
+
+    void capture(callback_t callback, bool damage_only)
+    {
+        requests.push_back({callback, damage_only});
+        update_hooks();
+        output->render->schedule_redraw();
+    }
+
+    void start_stream(stream_callback_t callback)
+    {
+        stream_callback = callback;
+        ++stream_id;
+        dropped_frames = 0;
+        update_hooks();
+        output->render->damage_whole();
+    }
+
+    void stop_stream()
+    {
+        stream_callback = nullptr;
+        ++stream_id;
+        update_hooks();
+    }
+
+    /** Queue a readback of the frame which is being presented */
+    void request_stream_frame()
+    {
+        int free_slots = std::count_if(slots.begin(), slots.end(),
+            [] (const readback_slot_t& slot) { return !slot.in_flight; });
+
+        if (free_slots <= (int)requests.size())
+        {
+            ++dropped_frames;
+            return;
+        }
+
+        uint32_t id = stream_id, time = get_current_time();
+        requests.push_back({[=] (std::shared_ptr<const image_io::image_t> frame)
+        {
+            if (id == stream_id && stream_callback)
+                stream_callback(frame, time);
+        }, true});
+    }
+
+    void pass_through(const wf_framebuffer_base& source,
+        const wf_framebuffer_base& destination)
+    {
+        OpenGL::render_begin(destination);
+        OpenGL::bind_framebuffer(GL_READ_FRAMEBUFFER, source.fb);
+        GL_CALL(glBlitFramebuffer(0, 0, source.viewport_width, source.viewport_height,
+                0, 0, destination.viewport_width, destination.viewport_height,
+                GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        OpenGL::render_end();
+
+        last_source_fb = source.fb;
+        last_width = source.viewport_width;
+        last_height = source.viewport_height;
+        accumulated_damage |= output->render->get_scheduled_damage();
+
+        if (stream_callback)
+            request_stream_frame();
+
+        start_readbacks();
+    }
+
+    /**
+     * Runs after each frame, even if it wasn't repainted. Completes
+     * finished readbacks, and starts the ones which couldn't be started
+     * during the repaint.
+     */
+    void poll()
+    {
+        complete_readbacks();
+        if (last_width > 0)
+            start_readbacks();
+
+        if (!in_flight.empty() || !requests.empty())
+            output->render->schedule_redraw();
+
+        update_hooks();
+    }
+
+    void start_readbacks()
+    {
+        while (!requests.empty())
+        {
+            auto it = std::find_if(slots.begin(), slots.end(),
+                [] (const readback_slot_t& slot) { return !slot.in_flight; });
+
+            /* All buffers in use, retry after the next frame */
+            if (it == slots.end())
+                break;
+
+            start_readback(*it, requests.front());
+            in_flight.push_back(it - slots.begin());
+            requests.pop_front();
+        }
+    }
+
+    /** @return The box to read for the given request, in framebuffer coords */
+    wlr_box get_readback_box(const request_t& request)
+    {
+        wlr_box full = {0, 0, last_width, last_height};
+        if (!request.damage_only || !last_frame ||
+            last_frame->width != last_width || last_frame->height != last_height)
+        {
+            return full;
+        }
+
+        auto damage = accumulated_damage & output->render->get_damage_box();
+        if (damage.empty())
+            return {0, 0, 0, 0};
+
+        auto fb = output->render->get_target_framebuffer();
+        auto box = fb.framebuffer_box_from_damage_box(
+            wlr_box_from_pixman_box(damage.get_extents()));
+
+        return wf_geometry_intersection(box, full);
+    }
+
+    void start_readback(readback_slot_t& slot, const request_t& request)
+    {
+        slot.box = get_readback_box(request);
+        slot.frame_width = last_width;
+        slot.frame_height = last_height;
+        slot.callback = request.callback;
+        slot.in_flight = true;
+        accumulated_damage.clear();
+
+        if (slot.box.width <= 0 || slot.box.height <= 0)
+            return;
+
+        OpenGL::render_begin();
+        if (!slot.pbo)
+        {
+            GL_CALL(glGenBuffers(1, &slot.pbo));
+        }
+
+        OpenGL::bind_framebuffer(GL_READ_FRAMEBUFFER, last_source_fb);
+        GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+        GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER,
+                slot.box.width * slot.box.height * 4, NULL, GL_STREAM_READ));
+
+        /* With a pack buffer bound, this only schedules the copy */
+        GL_CALL(glReadPixels(slot.box.x,
+                last_height - slot.box.y - slot.box.height,
+                slot.box.width, slot.box.height,
+                GL_RGBA, GL_UNSIGNED_BYTE, 0));
+
+        slot.fence = GL_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        GL_CALL(glFlush());
+        GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        OpenGL::render_end();
+    }
+
+    /** @return true if the GPU has finished copying to the slot's buffer */
+    bool is_ready(readback_slot_t& slot)
+    {
+        if (!slot.fence)
+            return true;
+
+        auto status = GL_CALL(glClientWaitSync(slot.fence, 0, 0));
+        return status == GL_ALREADY_SIGNALED ||
+            status == GL_CONDITION_SATISFIED;
+    }
+
+    /* Readbacks are completed in order, because damage-only captures
+     * build on top of the previous ones */
+    void complete_readbacks()
+    {
+        if (in_flight.empty())
+            return;
+
+        OpenGL::render_begin();
+        while (!in_flight.empty() && is_ready(slots[in_flight.front()]))
+        {
+            auto& slot = slots[in_flight.front()];
+            in_flight.pop_front();
+            complete_readback(slot);
+        }
+        OpenGL::render_end();
+    }
+
+    void complete_readback(readback_slot_t& slot)
+    {
+        bool full = slot.box.x == 0 && slot.box.y == 0 &&
+            slot.box.width == slot.frame_width &&
+            slot.box.height == slot.frame_height;
+
+        auto frame = last_frame;
+        if (!frame || full || frame->width != slot.frame_width ||
+            frame->height != slot.frame_height)
+        {
+            frame = std::make_shared<image_io::image_t> ();
+            frame->width = slot.frame_width;
+            frame->height = slot.frame_height;
+            frame->format = GL_RGBA;
+            frame->pixels.resize(frame->width * frame->height * 4);
+        } else if (frame.use_count() > 1)
+        {
+            /* The previous frame is still used, for ex. by an encoder */
+            frame = std::make_shared<image_io::image_t> (*frame);
+        }
+
+        if (slot.fence)
+        {
+            GL_CALL(glDeleteSync(slot.fence));
+            slot.fence = 0;
+
+            int row_size = slot.box.width * 4;
+            GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+            auto data = (const uint8_t*)GL_CALL(glMapBufferRange(
+                    GL_PIXEL_PACK_BUFFER, 0, row_size * slot.box.height,
+                    GL_MAP_READ_BIT));
+
+            /* GL rows go bottom to top */
+            for (int i = 0; data && i < slot.box.height; i++)
+            {
+                int dst_row = slot.box.y + slot.box.height - i - 1;
+                std::memcpy(frame->pixels.data() +
+                    (dst_row * frame->width + slot.box.x) * 4,
+                    data + i * row_size, row_size);
+            }
+
+            GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+            GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        }
+
+        last_frame = frame;
+        slot.in_flight = false;
+
+        auto callback = std::move(slot.callback);
+        callback(frame);
+    }
+};
+
+frame_capture_t::frame_capture_t(wf::output_t *output, int ring_size)
+    : pimpl(new impl(output, ring_size)) { }
+frame_capture_t::~frame_capture_t() = default;
+void frame_capture_t::capture(callback_t callback, bool damage_only) { pimpl->capture(callback, damage_only); }
+void frame_capture_t::start_stream(stream_callback_t callback) { pimpl->start_stream(callback); }
+void frame_capture_t::stop_stream() { pimpl->stop_stream(); }
+uint32_t frame_capture_t::get_dropped_frames() const { return pimpl->dropped_frames; }
+}
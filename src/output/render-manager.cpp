@@ -1,4 +1,6 @@
 #include "render-manager.hpp"
+#include "scanout.hpp"
+#include "../core/trace.hpp"
 #include "workspace-stream.hpp"
 #include "output.hpp"
 #include "../core/core-impl.hpp"
@@ -9,6 +11,7 @@
 #include "debug.hpp"
 #include "../main.hpp"
 #include <algorithm>
+#include <unordered_set>
 #include <nonstd/reverse.hpp>
 #include <nonstd/safe-list.hpp>
 
@@ -19,6 +22,9 @@ extern "C"
 #include <wlr/render/wlr_renderer.h>
 #undef static
 #include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/types/wlr_presentation_time.h>
 #include <wlr/util/region.h>
 }
 
@@ -36,11 +42,24 @@ struct output_damage_t
     wlr_output_damage *damage_manager;
     output_t *wo;
 
+    wf_option max_rects, merge_overhead;
+    damage_stats_t stats;
+
+    /* Whether a frame was committed and its present event hasn't arrived */
+    bool pending_presentation = false;
+
+    /* See render_manager::set_viewport_offset() */
+    wf_point viewport_offset = {0, 0};
+
     output_damage_t(output_t *output)
     {
         this->output = output->handle;
         this->wo = output;
 
+        auto section = get_core().config->get_section("core");
+        max_rects = section->get_option("damage_max_rects", "32");
+        merge_overhead = section->get_option("damage_merge_overhead", "0.25");
+
         damage_manager = wlr_output_damage_create(this->output);
 
         on_damage_destroy.set_callback([=] (void *) { damage_manager = nullptr; });
@@ -52,6 +71,7 @@ struct output_damage_t
      */
     void damage(const wlr_box& box)
     {
+        WF_TRACE("damage", "damage box");
         frame_damage |= box;
 
         auto sbox = box;
@@ -66,6 +86,7 @@ struct output_damage_t
      */
     void damage(const wf_region& region)
     {
+        WF_TRACE("damage", "damage region");
         frame_damage |= region;
         if (damage_manager)
         {
@@ -83,6 +104,7 @@ struct output_damage_t
      */
     bool make_current(bool& need_swap)
     {
+        WF_TRACE("paint", "make current");
         if (!damage_manager)
             return false;
 
@@ -93,12 +115,129 @@ struct output_damage_t
         if (!r) return false;
 
         frame_damage |= tmp_region;
-        if (runtime_config.no_damage_track)
+        /* While the viewport is scrolled, the whole output moves each frame */
+        if (runtime_config.no_damage_track || viewport_offset != wf_point{0, 0})
             frame_damage |= get_damage_box();
 
+        simplify_damage();
         return true;
     }
 
+    /**
+     * Merge the damage rectangles, so that renderers issue fewer draws.
+     *
+     * Neighbouring rectangles are merged into their bounding box when it
+     * isn't much bigger than the rectangles themselves (less than
+     * damage_merge_overhead of its area), and then the cheapest merges are
+     * done until there are at most damage_max_rects rectangles. If the
+     * resulting region still has more rectangles, its extents are used.
+     */
+    void simplify_damage()
+    {
+        const int limit = std::max(max_rects->as_cached_int(), 1);
+        const double overhead = merge_overhead->as_cached_double();
+
+        std::vector<pixman_box32_t> boxes(frame_damage.begin(),
+            frame_damage.end());
+        int rects_in = boxes.size();
+
+        /* Merging is quadratic, give up on heavily fragmented damage */
+        if ((int)boxes.size() > 16 * limit)
+        {
+            boxes = {frame_damage.get_extents()};
+        }
+
+        auto area = [] (const pixman_box32_t& box) {
+            return int64_t(box.x2 - box.x1) * (box.y2 - box.y1);
+        };
+
+        while (boxes.size() > 1)
+        {
+            /* pixman keeps rectangles sorted in bands, so neighbours in the
+             * list are usually close to each other */
+            size_t best = 0;
+            double best_cost = 2.0;
+            for (size_t i = 0; i + 1 < boxes.size(); i++)
+            {
+                auto& a = boxes[i];
+                auto& b = boxes[i + 1];
+                pixman_box32_t merged = {std::min(a.x1, b.x1),
+                    std::min(a.y1, b.y1), std::max(a.x2, b.x2),
+                    std::max(a.y2, b.y2)};
+
+                double cost = 1.0 * (area(merged) - area(a) - area(b)) /
+                    std::max(area(merged), int64_t(1));
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best = i;
+                }
+            }
+
+            if ((int)boxes.size() <= limit && best_cost > overhead)
+                break;
+
+            auto& a = boxes[best];
+            auto& b = boxes[best + 1];
+            a = {std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+                std::max(a.x2, b.x2), std::max(a.y2, b.y2)};
+            boxes.erase(boxes.begin() + best + 1);
+        }
+
+        /* Merged boxes may overlap, and pixman would split them in bands
+         * again, so merge until all boxes are disjoint */
+        auto overlap = [] (const pixman_box32_t& a, const pixman_box32_t& b) {
+            return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+        };
+
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (size_t i = 0; i < boxes.size() && !merged; i++)
+            {
+                for (size_t j = i + 1; j < boxes.size() && !merged; j++)
+                {
+                    if (!overlap(boxes[i], boxes[j]))
+                        continue;
+
+                    auto& a = boxes[i];
+                    auto& b = boxes[j];
+                    a = {std::min(a.x1, b.x1), std::min(a.y1, b.y1),
+                        std::max(a.x2, b.x2), std::max(a.y2, b.y2)};
+                    boxes.erase(boxes.begin() + j);
+                    merged = true;
+                }
+            }
+        }
+
+        if ((int)boxes.size() != rects_in)
+        {
+            wf_region simplified;
+            for (auto& box : boxes)
+                simplified |= wlr_box_from_pixman_box(box);
+
+            /* Disjoint boxes can still be split in bands, keep the original
+             * if it turns out simpler */
+            int rects = std::distance(simplified.begin(), simplified.end());
+            if (rects <= rects_in || rects_in > limit)
+                frame_damage = std::move(simplified);
+        }
+
+        if (std::distance(frame_damage.begin(), frame_damage.end()) > limit)
+        {
+            frame_damage =
+                wf_region{wlr_box_from_pixman_box(frame_damage.get_extents())};
+        }
+
+        int rects_out = std::distance(frame_damage.begin(), frame_damage.end());
+        stats.frames++;
+        stats.total_rects_in += rects_in;
+        stats.total_rects_out += rects_out;
+        stats.max_rects_in = std::max(stats.max_rects_in, rects_in);
+        stats.max_rects_out = std::max(stats.max_rects_out, rects_out);
+    }
+
     /**
      * Return the damage that has been scheduled for the next frame up to now,
      * or, if in a repaint, the damage for the current frame
@@ -113,6 +252,7 @@ struct output_damage_t
      */
     void swap_buffers(wf_region& swap_damage)
     {
+        WF_TRACE("paint", "swap buffers");
         if (!output)
             return;
 
@@ -127,7 +267,8 @@ struct output_damage_t
 
         wlr_output_set_damage(output,
             const_cast<wf_region&> (swap_damage).to_pixman());
-        wlr_output_commit(output);
+        if (wlr_output_commit(output))
+            pending_presentation = true;
         frame_damage.clear();
     }
 
@@ -194,6 +335,18 @@ struct output_damage_t
         damage({-vx * sw, -vy * sh, vw * sw, vh * sh});
     }
 
+    /**
+     * Same as render_manager::set_viewport_offset()
+     */
+    void set_viewport_offset(wf_point offset)
+    {
+        if (offset == viewport_offset)
+            return;
+
+        viewport_offset = offset;
+        damage(get_damage_box());
+    }
+
     wf::wl_idle_call idle_damage;
     /**
      * Same as render_manager::damage_whole_idle()
@@ -227,6 +380,9 @@ struct effect_hook_manager_t
 
     void run_effects(output_effect_type_t type)
     {
+        WF_TRACE("paint", type == OUTPUT_EFFECT_PRE ? "pre effects" :
+            (type == OUTPUT_EFFECT_OVERLAY ? "overlay effects" : "post effects"));
+
         effects[type].for_each([] (auto effect)
             { (*effect)(); });
     }
@@ -283,6 +439,7 @@ struct postprocessing_manager_t
      * damage. So, we need to keep the whole buffer each frame. */
     void run_post_effects()
     {
+        WF_TRACE("paint", "postprocessing");
         static wf_framebuffer_base default_framebuffer;
         default_framebuffer.tex = default_framebuffer.fb = 0;
 
@@ -326,28 +483,206 @@ struct postprocessing_manager_t
     }
 };
 
+/**
+ * frame_scheduler_t delays repaints until shortly before the next vblank,
+ * so that client commits which arrive during the refresh cycle are shown
+ * a frame earlier.
+ *
+ * The vblank times are taken from the present events. A frame event which
+ * follows one of our commits arrives at vblank, and the repaint is started
+ * after refresh - predicted render time - margin, where the prediction is
+ * the longest of the recent repaints. Other frame events are scheduled
+ * while the output is idle, so the repaint is started immediately.
+ */
+struct frame_scheduler_t
+{
+    static constexpr int HISTORY_SIZE = 32;
+
+    output_t *output;
+    std::function<bool()> paint;
+    wf::wl_timer delayed_paint;
+    wf_option enabled, margin;
+
+    /* Recent render times in microseconds */
+    int64_t render_times[HISTORY_SIZE] = {0};
+    int next_render_time = 0;
+
+    /* Time of the last vblank, from the last present event */
+    int64_t last_vblank = 0;
+    /* Whether a frame was committed and its frame event hasn't arrived */
+    bool waiting_vblank = false;
+    /* Whether delayed_paint is armed */
+    bool paint_pending = false;
+    /* The vblank the current repaint should be ready for, 0 if unknown */
+    int64_t deadline = 0;
+    /* When the last repaint which didn't commit a frame ended */
+    int64_t last_empty_paint = 0;
+
+    frame_schedule_stats_t stats;
+
+    frame_scheduler_t(output_t *output, std::function<bool()> paint)
+    {
+        this->output = output;
+        this->paint = paint;
+
+        auto section = get_core().config->get_section("core");
+        enabled = section->get_option("frame_scheduling", "1");
+        margin = section->get_option("frame_schedule_margin", "2");
+    }
+
+    static int64_t get_time_us()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+    }
+
+    /** @return The duration of a refresh cycle, or 0 if unknown */
+    int64_t get_refresh_us()
+    {
+        if (output->handle->refresh <= 0)
+            return 0;
+
+        return 1000000000ll / output->handle->refresh;
+    }
+
+    int64_t predict_render_time()
+    {
+        return *std::max_element(render_times, render_times + HISTORY_SIZE);
+    }
+
+    /** @return The time of the first vblank after now in microseconds, or 0
+     * if unknown */
+    int64_t predict_next_vblank()
+    {
+        int64_t refresh = get_refresh_us();
+        if (refresh <= 0 || last_vblank == 0)
+            return 0;
+
+        int64_t now = get_time_us();
+        int64_t next = last_vblank + refresh;
+        if (next <= now)
+            next += ((now - next) / refresh + 1) * refresh;
+
+        return next;
+    }
+
+    /** @return The time of the next vblank, or now if unknown, in ms */
+    uint32_t predict_presentation_time()
+    {
+        int64_t next = predict_next_vblank();
+        return (next ? next : get_time_us()) / 1000;
+    }
+
+    /** Called on each present event of the output */
+    void handle_present(const timespec& when)
+    {
+        last_vblank = when.tv_sec * 1000000ll + when.tv_nsec / 1000;
+    }
+
+    /** Called on each frame event of the output */
+    void handle_frame()
+    {
+        /* The delayed repaint will handle whatever caused this frame event,
+         * re-arming it would only push it back */
+        if (paint_pending)
+            return;
+
+        bool vblank = waiting_vblank;
+        waiting_vblank = false;
+
+        deadline = predict_next_vblank();
+        int64_t delay = 0;
+        if (vblank && deadline && enabled->as_cached_int())
+        {
+            delay = deadline - get_time_us() - predict_render_time() -
+                margin->as_cached_double() * 1000;
+        } else if (!vblank && deadline &&
+            last_empty_paint > deadline - get_refresh_us())
+        {
+            /* A repaint in this refresh cycle had nothing to commit, for ex.
+             * an animation which didn't damage anything. Wait for the next
+             * cycle instead of spinning on idle frame events. */
+            delay = deadline - get_time_us();
+            deadline += get_refresh_us();
+        }
+
+        stats.last_delay = std::max<int64_t>(delay, 0) / 1000.0;
+
+        /* wl_event_loop timers have a resolution of 1ms */
+        if (delay < 1000)
+        {
+            run_paint();
+            return;
+        }
+
+        paint_pending = true;
+        delayed_paint.set_timeout(delay / 1000, [=] () { run_paint(); });
+    }
+
+    void run_paint()
+    {
+        paint_pending = false;
+
+        int64_t start = get_time_us();
+        if (!paint())
+        {
+            last_empty_paint = get_time_us();
+            return;
+        }
+
+        waiting_vblank = true;
+        int64_t end = get_time_us();
+        render_times[next_render_time] = end - start;
+        next_render_time = (next_render_time + 1) % HISTORY_SIZE;
+
+        ++stats.frames;
+        stats.predicted_render_time = predict_render_time() / 1000.0;
+
+        if (deadline && end > deadline)
+            ++stats.misses;
+    }
+};
+
 class wf::render_manager::impl
 {
   public:
-    wf::wl_listener_wrapper on_frame;
+    wf::wl_listener_wrapper on_frame, on_present;
 
     output_t *output;
     std::unique_ptr<output_damage_t> output_damage;
     std::unique_ptr<effect_hook_manager_t> effects;
     std::unique_ptr<postprocessing_manager_t> postprocessing;
+    std::unique_ptr<frame_scheduler_t> scheduler;
+
+    latency_histogram_t input_latency;
+    /* The last input event which was shown on the output */
+    uint64_t last_input_event;
 
     impl(output_t *o)
         : output(o)
     {
+        last_input_event = get_core_impl().input->latency.get_last_event();
+
         output_damage = std::make_unique<output_damage_t> (o);
         output_damage->damage(output_damage->get_damage_box());
 
+        direct_scanout = wf::get_core().config->get_section("core")
+            ->get_option("direct_scanout", "1");
+
         effects = std::make_unique<effect_hook_manager_t> ();
         postprocessing = std::make_unique<postprocessing_manager_t>(o);
 
-        on_frame.set_callback([&] (void*) { paint(); });
+        scheduler = std::make_unique<frame_scheduler_t> (o,
+            [=] () { return paint(); });
+        on_frame.set_callback([&] (void*) { scheduler->handle_frame(); });
         on_frame.connect(&output_damage->damage_manager->events.frame);
 
+        on_present.set_callback([&] (void *data) {
+            handle_present((wlr_output_event_present*) data);
+        });
+        on_present.connect(&o->handle->events.present);
+
         init_default_streams();
         output_damage->schedule_repaint();
     }
@@ -396,6 +731,45 @@ class wf::render_manager::impl
         output_damage->schedule_repaint();
     }
 
+    wf::safe_list_t<frame_callback_t*> animations;
+    void add_animation(frame_callback_t *callback)
+    {
+        rem_animation(callback);
+        animations.push_back(callback);
+        output_damage->schedule_repaint();
+    }
+
+    void rem_animation(frame_callback_t *callback)
+    {
+        animations.remove_all(callback);
+    }
+
+    /**
+     * Advance all animations to the presentation time of the frame which
+     * is about to be painted. The next frame is requested only while at
+     * least one animation is still running.
+     */
+    void run_animations()
+    {
+        WF_TRACE("paint", "animations");
+        if (!animations.size())
+            return;
+
+        uint32_t frame_time = scheduler->predict_presentation_time();
+        std::vector<frame_callback_t*> finished;
+        animations.for_each([&] (frame_callback_t *callback)
+        {
+            if (!(*callback)(frame_time))
+                finished.push_back(callback);
+        });
+
+        for (auto callback : finished)
+            animations.remove_all(callback);
+
+        if (animations.size())
+            output_damage->schedule_repaint();
+    }
+
     int output_inhibit_counter = 0;
     void add_inhibit(bool add)
     {
@@ -424,6 +798,176 @@ class wf::render_manager::impl
         return fb;
     }
 
+    /* Direct scanout of fullscreen views */
+    wf_option direct_scanout;
+    bool scanout_active = false;
+    /* Set when the backend refused to scan out the current buffer, so that
+     * it isn't retried each frame */
+    wlr_buffer *scanout_failed_buffer = nullptr;
+
+    /** @return true if a cursor on the output is rendered in software */
+    bool has_software_cursor()
+    {
+        wlr_output_cursor *cursor;
+        wl_list_for_each(cursor, &output->handle->cursors, link)
+        {
+            if (cursor->enabled && cursor->visible &&
+                cursor != output->handle->hardware_cursor)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Collect the state for check_scanout()
+     *
+     * @param view Set to the topmost view which is visible on the output
+     */
+    scanout_state_t get_scanout_state(wayfire_view& view)
+    {
+        scanout_state_t state;
+        state.custom_renderer = bool(renderer);
+        state.has_overlay_effects =
+            effects->effects[OUTPUT_EFFECT_OVERLAY].size() > 0;
+        state.has_post_effects = postprocessing->post_effects.size() > 0;
+        state.inhibited = output_inhibit_counter > 0;
+        state.software_cursor = has_software_cursor();
+
+        auto& drag_icon = wf::get_core_impl().input->drag_icon;
+        state.drag_icon = drag_icon && drag_icon->is_mapped();
+
+        state.viewport_scrolled =
+            output_damage->viewport_offset != wf_point{0, 0};
+
+        state.output_geometry = output->get_relative_geometry();
+        state.output_scale = output->handle->scale;
+        state.output_transform = output->handle->transform;
+
+        auto views = output->workspace->get_views_on_workspace(
+            output->workspace->get_current_workspace(), wf::VISIBLE_LAYERS,
+            false);
+
+        for (auto& v : views)
+        {
+            auto box = wf_geometry_intersection(v->get_bounding_box(),
+                state.output_geometry);
+            if (v->is_mapped() && box.width > 0 && box.height > 0)
+            {
+                view = v;
+                break;
+            }
+        }
+
+        if (!view)
+            return state;
+
+        state.has_view = true;
+        state.view_fullscreen = view->fullscreen;
+        state.view_transformed = view->has_transformer();
+        state.view_geometry = view->get_output_geometry();
+        state.view_surface_count = 0;
+        view->for_each_surface([&] (wf::surface_interface_t*, wf_point) {
+            ++state.view_surface_count;
+        });
+
+        wf_region opaque_test{state.output_geometry};
+        view->subtract_opaque(opaque_test,
+            state.view_geometry.x, state.view_geometry.y);
+        state.view_opaque = opaque_test.empty();
+
+        auto surface = view->get_keyboard_focus_surface();
+        if (surface && surface->buffer)
+        {
+            state.has_buffer = true;
+            state.buffer_scale = surface->current.scale;
+            state.buffer_transform = surface->current.transform;
+        }
+
+        return state;
+    }
+
+    /**
+     * Try to show the topmost view's buffer directly on the output.
+     *
+     * @return SCANOUT_FRAME_COMMIT if a frame was committed by direct scanout,
+     *  SCANOUT_FRAME_UNCHANGED if the scanned out buffer is still current
+     *  and nothing was committed, SCANOUT_FRAME_COMPOSITE otherwise
+     */
+    scanout_frame_t try_direct_scanout()
+    {
+        WF_TRACE("paint", "direct scanout");
+        if (!direct_scanout->as_cached_int())
+        {
+            stop_direct_scanout("disabled");
+            return SCANOUT_FRAME_COMPOSITE;
+        }
+
+        wayfire_view view;
+        auto result = check_scanout(get_scanout_state(view));
+        if (result != SCANOUT_OK)
+        {
+            scanout_failed_buffer = nullptr;
+            stop_direct_scanout(scanout_result_to_string(result));
+            return SCANOUT_FRAME_COMPOSITE;
+        }
+
+        auto buffer = view->get_keyboard_focus_surface()->buffer;
+        if (buffer == scanout_failed_buffer)
+            return SCANOUT_FRAME_COMPOSITE;
+
+        /* Nothing changed since the last scanned out buffer */
+        auto damage = output_damage->get_scheduled_damage() &
+            output_damage->get_damage_box();
+        auto frame = get_scanout_frame(scanout_active, !damage.empty());
+        if (frame == SCANOUT_FRAME_UNCHANGED)
+            return frame;
+
+        /* The backend may not support scanout of this buffer, for ex.
+         * shm buffers or the headless backend */
+        if (!wlr_output_attach_buffer(output->handle, buffer) ||
+            !wlr_output_commit(output->handle))
+        {
+            wlr_output_rollback(output->handle);
+            scanout_failed_buffer = buffer;
+            stop_direct_scanout("buffer rejected by the backend");
+            return SCANOUT_FRAME_COMPOSITE;
+        }
+
+        if (!scanout_active)
+        {
+            log_info("%s: direct scanout of view %s",
+                output->handle->name, view->get_title().c_str());
+        }
+
+        view->for_each_surface([&] (wf::surface_interface_t *surface, wf_point)
+        {
+            sampled_surfaces.insert(surface);
+        });
+
+        scanout_active = true;
+        scanout_failed_buffer = nullptr;
+        output_damage->pending_presentation = true;
+        output_damage->frame_damage.clear();
+        return SCANOUT_FRAME_COMMIT;
+    }
+
+    /** Go back to composition, if direct scanout was active */
+    void stop_direct_scanout(const char *reason)
+    {
+        if (!scanout_active)
+            return;
+
+        log_info("%s: direct scanout stopped: %s",
+            output->handle->name, reason);
+        scanout_active = false;
+
+        /* The output buffers haven't been updated during scanout */
+        output_damage->damage_whole();
+    }
+
     /* Actual rendering functions */
 
     /**
@@ -475,6 +1019,7 @@ class wf::render_manager::impl
      */
     void render_output(wf_region& swap_damage)
     {
+        WF_TRACE("paint", "render");
         if (renderer)
         {
             renderer(get_target_framebuffer());
@@ -490,27 +1035,52 @@ class wf::render_manager::impl
 
     /**
      * Repaints the whole output, includes all effects and hooks
+     *
+     * @return true if a new frame was committed to the output
      */
-    void paint()
+    bool paint()
     {
+        WF_TRACE_DETAIL("paint", "paint", output->handle->name);
+
         /* Part 1: frame setup: query damage, etc. */
+        sampled_surfaces.clear();
         timespec repaint_started;
         clock_gettime(CLOCK_MONOTONIC, &repaint_started);
         wf_region swap_damage;
 
+        run_animations();
         effects->run_effects(OUTPUT_EFFECT_PRE);
 
+        switch (try_direct_scanout())
+        {
+            case SCANOUT_FRAME_COMMIT:
+                record_input_latency(repaint_started);
+                post_paint();
+                return true;
+
+            case SCANOUT_FRAME_UNCHANGED:
+                /* Same as a repaint without damage: nothing is committed,
+                 * but frame callbacks still have to go out */
+                skip_input_latency(repaint_started);
+                post_paint();
+                return false;
+
+            case SCANOUT_FRAME_COMPOSITE:
+                break;
+        }
+
         bool needs_swap;
         if (!output_damage->make_current(needs_swap))
-            return;
+            return false;
 
         if (!needs_swap && !constant_redraw_counter)
         {
             /* Optimization: the output doesn't need a swap (so isn't damaged),
              * and no plugin wants custom redrawing - we can just skip the whole
              * repaint */
+            skip_input_latency(repaint_started);
             post_paint();
-            return;
+            return false;
         }
 
         bind_output();
@@ -540,7 +1110,27 @@ class wf::render_manager::impl
         /* Part 5: finalize frame: swap buffers, send frame_done, etc */
         OpenGL::unbind_output(output);
         output_damage->swap_buffers(swap_damage);
+        record_input_latency(repaint_started);
         post_paint();
+        return true;
+    }
+
+    static int64_t timespec_to_us(const timespec& ts)
+    {
+        return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000;
+    }
+
+    void record_input_latency(const timespec& repaint_started)
+    {
+        get_core_impl().input->latency.frame_committed(last_input_event,
+            timespec_to_us(repaint_started), input_latency);
+    }
+
+    /** Consume the input events of a repaint which didn't commit a frame */
+    void skip_input_latency(const timespec& repaint_started)
+    {
+        get_core_impl().input->latency.frame_skipped(last_input_event,
+            timespec_to_us(repaint_started));
     }
 
     /**
@@ -548,11 +1138,74 @@ class wf::render_manager::impl
      */
     void post_paint()
     {
+        WF_TRACE("paint", "post paint");
         effects->run_effects(OUTPUT_EFFECT_POST);
 
         if (constant_redraw_counter)
             output_damage->schedule_repaint();
 
+        if (output_damage->pending_presentation)
+        {
+            feedback_surfaces.insert(sampled_surfaces.begin(),
+                sampled_surfaces.end());
+        }
+
+        send_frame_done();
+    }
+
+    void send_frame_done()
+    {
+        frame_done_requested = false;
+        frame_done_timer.disconnect();
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (auto& view : get_visible_views())
+        {
+            view->for_each_surface([&] (wf::surface_interface_t *surface,
+                    wf_point) { surface->send_frame_done(now); });
+        }
+    }
+
+    /* Whether frame done was requested by a commit without damage */
+    bool frame_done_requested = false;
+    wf::wl_timer frame_done_timer;
+
+    /**
+     * Send frame done at the next vblank, without repainting. If the output
+     * is active, this is its next present event. Otherwise, there won't be
+     * any, so a timer is set for the predicted vblank. Sending it right away
+     * would let idle clients redraw in a busy loop.
+     */
+    void schedule_frame_done()
+    {
+        if (frame_done_requested)
+            return;
+        frame_done_requested = true;
+
+        int64_t now = frame_scheduler_t::get_time_us();
+        int64_t next = scheduler->predict_next_vblank();
+        int64_t delay = next ? next - now : scheduler->get_refresh_us();
+        if (delay <= 0)
+            delay = 16000;
+
+        /* A timeout of 0 would disarm the timer */
+        frame_done_timer.set_timeout(std::max<int64_t>((delay + 999) / 1000, 1),
+            [=] () { send_requested_frame_done(); });
+    }
+
+    void send_requested_frame_done()
+    {
+        if (!frame_done_requested)
+            return;
+
+        WF_TRACE("paint", "frame done only");
+        send_frame_done();
+    }
+
+    /** @return The mapped views whose surfaces are shown on the output */
+    std::vector<wayfire_view> get_visible_views()
+    {
         /* TODO: do this only if the view isn't fully occluded by another */
         std::vector<wayfire_view> visible_views;
         if (renderer)
@@ -561,9 +1214,7 @@ class wf::render_manager::impl
                 wf::VISIBLE_LAYERS);
         } else
         {
-            visible_views = output->workspace->get_views_on_workspace(
-                output->workspace->get_current_workspace(),
-                wf::MIDDLE_LAYERS, false);
+            visible_views = get_views_in_viewport(wf::MIDDLE_LAYERS);
 
             // send to all panels/backgrounds/etc
             auto additional_views = output->workspace->get_views_in_layer(
@@ -573,16 +1224,83 @@ class wf::render_manager::impl
                 additional_views.begin(), additional_views.end());
         }
 
-        timespec repaint_ended;
-        clock_gettime(CLOCK_MONOTONIC, &repaint_ended);
-        for (auto& view : visible_views)
+        auto it = std::remove_if(visible_views.begin(), visible_views.end(),
+            [] (wayfire_view view) { return !view->is_mapped(); });
+        visible_views.erase(it, visible_views.end());
+        return visible_views;
+    }
+
+    /**
+     * @return The views in the given layers which are visible in the part of
+     * the workspace grid shown on the output, that is, the current workspace
+     * translated by the viewport offset
+     */
+    std::vector<wayfire_view> get_views_in_viewport(uint32_t layers)
+    {
+        auto offset = output_damage->viewport_offset;
+        if (offset == wf_point{0, 0})
         {
-            if (!view->is_mapped())
-                continue;
+            return output->workspace->get_views_on_workspace(
+                output->workspace->get_current_workspace(), layers, false);
+        }
 
-            for (auto& child : view->enumerate_surfaces())
-                child.surface->send_frame_done(repaint_ended);
+        auto views = output->workspace->get_views_in_layer(layers);
+        auto it = std::remove_if(views.begin(), views.end(),
+            [=] (wayfire_view view)
+        {
+            auto g = output->get_relative_geometry();
+            if (view->role != VIEW_ROLE_SHELL_VIEW)
+                g = g + offset;
+
+            if (view->has_transformer())
+                return !view->intersects_region(g);
+            return !(g & view->get_wm_geometry());
+        });
+
+        views.erase(it, views.end());
+        return views;
+    }
+
+    /* The surfaces rendered or scanned out in the current frame */
+    std::unordered_set<wf::surface_interface_t*> sampled_surfaces;
+    /* The surfaces sampled by the frames waiting for their present event */
+    std::unordered_set<wf::surface_interface_t*> feedback_surfaces;
+
+    /**
+     * Send presentation feedback to the surfaces sampled in the frames
+     * which were committed by us. Other commits (for ex. gamma changes)
+     * don't present new content, so they are ignored.
+     *
+     * The sampled surfaces may have been destroyed since, so they are only
+     * compared with the surfaces which are still visible.
+     */
+    void handle_present(wlr_output_event_present *present)
+    {
+        scheduler->handle_present(*present->when);
+        send_requested_frame_done();
+        if (!output_damage->pending_presentation)
+            return;
+        output_damage->pending_presentation = false;
+
+        wlr_presentation_event event;
+        event.output = present->output;
+        event.tv_sec = present->when->tv_sec;
+        event.tv_nsec = present->when->tv_nsec;
+        event.refresh = present->refresh;
+        event.seq = present->seq;
+        event.flags = present->flags;
+
+        for (auto& view : get_visible_views())
+        {
+            view->for_each_surface([&] (wf::surface_interface_t *surface,
+                    wf_point)
+            {
+                if (feedback_surfaces.count(surface))
+                    surface->send_presented(event);
+            });
         }
+
+        feedback_surfaces.clear();
     }
 
     /* Workspace stream implementation */
@@ -625,6 +1343,8 @@ class wf::render_manager::impl
 
         int ws_dx;
         int ws_dy;
+        /* Whether the current workspace is rendered with the viewport offset */
+        bool scrolled = false;
     };
 
     /**
@@ -705,8 +1425,10 @@ class wf::render_manager::impl
         offset.x -= og.x;
         offset.y -= og.y;
 
-        for (auto& child : drag_icon->enumerate_surfaces(offset))
-            schedule_surface(repaint, child.surface, child.position);
+        drag_icon->for_each_surface([&] (wf::surface_interface_t *surface,
+                wf_point position) {
+            schedule_surface(repaint, surface, position);
+        }, offset);
     }
 
     /**
@@ -726,8 +1448,15 @@ class wf::render_manager::impl
     void check_schedule_surfaces(workspace_stream_repaint_t& repaint,
         workspace_stream_t& stream)
     {
-        auto views = output->workspace->get_views_on_workspace(stream.ws,
-            wf::VISIBLE_LAYERS, false);
+        std::vector<wayfire_view> views;
+        if (repaint.scrolled)
+        {
+            views = get_views_in_viewport(wf::VISIBLE_LAYERS);
+        } else
+        {
+            views = output->workspace->get_views_on_workspace(stream.ws,
+                wf::VISIBLE_LAYERS, false);
+        }
 
         schedule_drag_icon(repaint);
 
@@ -764,8 +1493,10 @@ class wf::render_manager::impl
                 obox.x -= view_delta.x;
                 obox.y -= view_delta.y;
 
-                for (auto& child : view->enumerate_surfaces({obox.x, obox.y}))
-                    schedule_surface(repaint, child.surface, child.position);
+                view->for_each_surface([&] (wf::surface_interface_t *surface,
+                        wf_point position) {
+                    schedule_surface(repaint, surface, position);
+                }, {obox.x, obox.y});
             }
 
             ++it;
@@ -814,6 +1545,16 @@ class wf::render_manager::impl
         repaint.ws_dx = (x - cx) * g.width,
         repaint.ws_dy = (y - cy) * g.height;
 
+        /* Views of the neighbouring workspaces are rendered directly, at
+         * their position relative to the translated viewport */
+        auto offset = output_damage->viewport_offset;
+        if (&stream == current_ws_stream.get() && offset != wf_point{0, 0})
+        {
+            repaint.scrolled = true;
+            repaint.ws_dx += offset.x;
+            repaint.ws_dy += offset.y;
+        }
+
         return repaint;
     }
 
@@ -843,12 +1584,18 @@ class wf::render_manager::impl
                 repaint.fb.geometry.x = ds->pos.x;
                 repaint.fb.geometry.y = ds->pos.y;
                 ds->view->render_transformed(repaint.fb, ds->damage);
+                ds->view->for_each_surface(
+                    [&] (wf::surface_interface_t *surface, wf_point)
+                {
+                    sampled_surfaces.insert(surface);
+                });
             }
             else
             {
                 repaint.fb.geometry = fb_geometry;
                 ds->surface->simple_render(repaint.fb,
                     ds->pos.x, ds->pos.y, ds->damage);
+                sampled_surfaces.insert(ds->surface);
             }
         }
     }
@@ -856,6 +1603,7 @@ class wf::render_manager::impl
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1)
     {
+        WF_TRACE("paint", "workspace stream update");
         workspace_stream_repaint_t repaint =
             calculate_repaint_for_stream(stream, scale_x, scale_y);
 
@@ -890,18 +1638,27 @@ render_manager::~render_manager() = default;
 void render_manager::set_renderer(render_hook_t rh) { pimpl->set_renderer(rh); }
 void render_manager::set_redraw_always(bool always) { pimpl->set_redraw_always(always); }
 void render_manager::schedule_redraw() { pimpl->output_damage->schedule_repaint(); }
+void render_manager::schedule_frame_done() { pimpl->schedule_frame_done(); }
+void render_manager::add_animation(frame_callback_t *callback) { pimpl->add_animation(callback); }
+void render_manager::rem_animation(frame_callback_t *callback) { pimpl->rem_animation(callback); }
+uint32_t render_manager::get_frame_time() const { return pimpl->scheduler->predict_presentation_time(); }
 void render_manager::add_inhibit(bool add) { pimpl->add_inhibit(add); }
 void render_manager::add_effect(effect_hook_t* hook, output_effect_type_t type) {pimpl->effects->add_effect(hook, type); }
 void render_manager::rem_effect(effect_hook_t* hook) { pimpl->effects->rem_effect(hook); }
 void render_manager::add_post(post_hook_t* hook) { pimpl->postprocessing->add_post(hook); }
 void render_manager::rem_post(post_hook_t* hook) { pimpl->postprocessing->rem_post(hook); }
 wf_region render_manager::get_scheduled_damage() { return pimpl->output_damage->get_scheduled_damage(); }
+damage_stats_t render_manager::get_damage_stats() const { return pimpl->output_damage->stats; }
+frame_schedule_stats_t render_manager::get_frame_schedule_stats() const { return pimpl->scheduler->stats; }
+latency_histogram_t render_manager::get_input_latency() const { return pimpl->input_latency; }
 void render_manager::damage_whole() { pimpl->output_damage->damage_whole(); }
 void render_manager::damage_whole_idle() { pimpl->output_damage->damage_whole_idle(); }
 void render_manager::damage(const wlr_box& box) { pimpl->output_damage->damage(box); }
 void render_manager::damage(const wf_region& region) { pimpl->output_damage->damage(region); }
 wlr_box render_manager::get_damage_box() const { return pimpl->output_damage->get_damage_box(); }
 wlr_box render_manager::get_ws_box(std::tuple<int, int> ws) const { return pimpl->output_damage->get_ws_box(ws); }
+void render_manager::set_viewport_offset(wf_point offset) { pimpl->output_damage->set_viewport_offset(offset); }
+wf_point render_manager::get_viewport_offset() const { return pimpl->output_damage->viewport_offset; }
 wf_framebuffer render_manager::get_target_framebuffer() const { return pimpl->get_target_framebuffer(); }
 void render_manager::workspace_stream_start(workspace_stream_t& stream) { pimpl->workspace_stream_start(stream); }
 void render_manager::workspace_stream_update(workspace_stream_t& stream,
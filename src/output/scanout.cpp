@@ -0,0 +1,103 @@
+#include "scanout.hpp"
+
+namespace wf
+{
+scanout_result_t check_scanout(const scanout_state_t& state)
+{
+    if (state.custom_renderer)
+        return SCANOUT_CUSTOM_RENDERER;
+
+    if (state.has_overlay_effects || state.has_post_effects)
+        return SCANOUT_EFFECTS;
+
+    if (state.inhibited)
+        return SCANOUT_INHIBITED;
+
+    if (state.software_cursor)
+        return SCANOUT_SOFTWARE_CURSOR;
+
+    if (state.drag_icon)
+        return SCANOUT_DRAG_ICON;
+
+    if (state.viewport_scrolled)
+        return SCANOUT_VIEWPORT_SCROLLED;
+
+    if (!state.has_view || !state.has_buffer)
+        return SCANOUT_NO_VIEW;
+
+    if (!state.view_fullscreen)
+        return SCANOUT_NOT_FULLSCREEN;
+
+    if (state.view_transformed)
+        return SCANOUT_TRANSFORMED;
+
+    if (!state.view_opaque)
+        return SCANOUT_NOT_OPAQUE;
+
+    /* Popups, subsurfaces and decorations need composition */
+    if (state.view_surface_count != 1)
+        return SCANOUT_SUBSURFACES;
+
+    const auto& vg = state.view_geometry;
+    const auto& og = state.output_geometry;
+    if (vg.x != og.x || vg.y != og.y ||
+        vg.width != og.width || vg.height != og.height)
+    {
+        return SCANOUT_GEOMETRY_MISMATCH;
+    }
+
+    /* The buffer must have exactly the output's resolution and orientation */
+    if (state.buffer_scale != state.output_scale ||
+        state.buffer_transform != state.output_transform)
+    {
+        return SCANOUT_BUFFER_MISMATCH;
+    }
+
+    return SCANOUT_OK;
+}
+
+const char *scanout_result_to_string(scanout_result_t result)
+{
+    switch (result)
+    {
+        case SCANOUT_OK:
+            return "ok";
+        case SCANOUT_CUSTOM_RENDERER:
+            return "custom renderer";
+        case SCANOUT_EFFECTS:
+            return "overlay or post effects";
+        case SCANOUT_INHIBITED:
+            return "output inhibited";
+        case SCANOUT_SOFTWARE_CURSOR:
+            return "software cursor";
+        case SCANOUT_DRAG_ICON:
+            return "drag icon";
+        case SCANOUT_VIEWPORT_SCROLLED:
+            return "viewport scrolled";
+        case SCANOUT_NO_VIEW:
+            return "no client buffer";
+        case SCANOUT_NOT_FULLSCREEN:
+            return "view not fullscreen";
+        case SCANOUT_TRANSFORMED:
+            return "view transformed";
+        case SCANOUT_NOT_OPAQUE:
+            return "view not opaque";
+        case SCANOUT_SUBSURFACES:
+            return "view has subsurfaces";
+        case SCANOUT_GEOMETRY_MISMATCH:
+            return "view doesn't cover the output";
+        case SCANOUT_BUFFER_MISMATCH:
+            return "buffer scale or transform mismatch";
+    }
+
+    return "unknown";
+}
+
+scanout_frame_t get_scanout_frame(bool scanout_active, bool damaged)
+{
+    if (scanout_active && !damaged)
+        return SCANOUT_FRAME_UNCHANGED;
+
+    return SCANOUT_FRAME_COMMIT;
+}
+}
@@ -0,0 +1,91 @@
+#ifndef WF_SCANOUT_HPP
+#define WF_SCANOUT_HPP
+
+#include <geometry.hpp>
+#include <wayland-server.h>
+
+namespace wf
+{
+/**
+ * Everything which decides whether an output frame can be scanned out
+ * directly from a client buffer, instead of being composited.
+ *
+ * The state is collected by the render manager, so that the eligibility
+ * check itself doesn't depend on a running compositor or on the backend.
+ */
+struct scanout_state_t
+{
+    /* Output state */
+    bool custom_renderer = false;
+    bool has_overlay_effects = false;
+    bool has_post_effects = false;
+    bool inhibited = false;
+    bool software_cursor = false;
+    bool drag_icon = false;
+    bool viewport_scrolled = false;
+
+    wlr_box output_geometry = {0, 0, 0, 0};
+    float output_scale = 1.0;
+    wl_output_transform output_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+
+    /* The topmost view which is visible on the output, if any */
+    bool has_view = false;
+    bool view_fullscreen = false;
+    bool view_transformed = false;
+    bool view_opaque = false;
+    /* Number of mapped surfaces in the view's tree, incl. the view itself */
+    int view_surface_count = 0;
+    wlr_box view_geometry = {0, 0, 0, 0};
+
+    /* The client buffer of the view's main surface */
+    bool has_buffer = false;
+    int32_t buffer_scale = 1;
+    wl_output_transform buffer_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+};
+
+enum scanout_result_t
+{
+    SCANOUT_OK = 0,
+    SCANOUT_CUSTOM_RENDERER,
+    SCANOUT_EFFECTS,
+    SCANOUT_INHIBITED,
+    SCANOUT_SOFTWARE_CURSOR,
+    SCANOUT_DRAG_ICON,
+    SCANOUT_VIEWPORT_SCROLLED,
+    SCANOUT_NO_VIEW,
+    SCANOUT_NOT_FULLSCREEN,
+    SCANOUT_TRANSFORMED,
+    SCANOUT_NOT_OPAQUE,
+    SCANOUT_SUBSURFACES,
+    SCANOUT_GEOMETRY_MISMATCH,
+    SCANOUT_BUFFER_MISMATCH,
+};
+
+/** @return SCANOUT_OK if the frame can be scanned out directly, otherwise
+ *  the first reason why it can't be. */
+scanout_result_t check_scanout(const scanout_state_t& state);
+
+/** @return A human-readable description of the result, for logging */
+const char *scanout_result_to_string(scanout_result_t result);
+
+/** What a repaint does with an eligible view's buffer */
+enum scanout_frame_t
+{
+    /* The frame isn't scanned out, composite it as usual */
+    SCANOUT_FRAME_COMPOSITE = 0,
+    /* The buffer is already on screen and nothing changed: no commit */
+    SCANOUT_FRAME_UNCHANGED,
+    /* The buffer needs to be attached and committed to the output */
+    SCANOUT_FRAME_COMMIT,
+};
+
+/**
+ * Decide whether an eligible view's buffer needs a new output commit.
+ *
+ * @param scanout_active Whether the output currently scans out this view
+ * @param damaged Whether the output has damage scheduled for this frame
+ */
+scanout_frame_t get_scanout_frame(bool scanout_active, bool damaged);
+}
+
+#endif /* end of include guard: WF_SCANOUT_HPP */
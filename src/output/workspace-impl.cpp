@@ -6,6 +6,7 @@
 #include <render-manager.hpp>
 #include <signal-definitions.hpp>
 #include <opengl.hpp>
+#include "../view/view-impl.hpp"
 #include <list>
 #include <algorithm>
 #include <nonstd/reverse.hpp>
@@ -25,8 +26,24 @@ class output_layer_manager_t
 
     using layer_container = std::list<wayfire_view>;
     layer_container layers[TOTAL_LAYERS];
+    output_t *output;
+
+    /**
+     * Views in the middle layers follow the viewport origin of the output,
+     * see workspace_manager::get_viewport_origin()
+     */
+    void update_viewport_follow(wayfire_view view, uint32_t layer)
+    {
+        view->view_impl->follow_viewport(
+            (layer & MIDDLE_LAYERS) ? output : nullptr);
+    }
 
   public:
+    output_layer_manager_t(output_t *output)
+    {
+        this->output = output;
+    }
+
     constexpr int layer_index_from_mask(uint32_t layer_mask) const
     {
         return __builtin_ctz(layer_mask);
@@ -51,6 +68,7 @@ class output_layer_manager_t
         layer_container.erase(it, layer_container.end());
 
         view_layer = 0;
+        update_viewport_follow(view, 0);
     }
 
     /**
@@ -67,6 +85,7 @@ class output_layer_manager_t
         auto& layer_container = layers[layer_index_from_mask(layer)];
         layer_container.push_front(view);
         current_layer = layer;
+        update_viewport_follow(view, layer);
         view->damage();
     }
 
@@ -96,6 +115,7 @@ class output_layer_manager_t
 
         container.insert(it, view);
         get_view_layer(view) = layer;
+        update_viewport_follow(view, layer);
     }
 
     std::vector<wayfire_view> get_views_in_layer(uint32_t layers_mask)
@@ -132,6 +152,7 @@ class output_viewport_manager_t
     int vheight;
     int current_vx;
     int current_vy;
+    wf_point viewport_origin = {0, 0};
 
     std::vector<std::vector<
             std::unique_ptr<workspace_implementation_t>>> workspace_impls;
@@ -269,6 +290,11 @@ class output_viewport_manager_t
         return std::make_tuple(vwidth, vheight);
     }
 
+    wf_point get_viewport_origin()
+    {
+        return viewport_origin;
+    }
+
     void set_workspace(std::tuple<int, int> nPos)
     {
         GetTuple(nx, ny, nPos);
@@ -289,12 +315,21 @@ class output_viewport_manager_t
         auto dx = (current_vx - nx) * sw;
         auto dy = (current_vy - ny) * sh;
 
+        /* Views which follow the viewport origin change their position
+         * implicitly, only views which don't support it are moved */
+        viewport_origin.x -= dx;
+        viewport_origin.y -= dy;
         for (auto& v : output->workspace->get_views_in_layer(MIDDLE_LAYERS))
         {
+            if (v->view_impl->viewport_aware)
+                continue;
+
             v->move(v->get_wm_geometry().x + dx,
                 v->get_wm_geometry().y + dy);
         }
 
+        output->render->damage_whole();
+
         change_viewport_signal data;
         data.old_viewport = std::make_tuple(current_vx, current_vy);
         data.new_viewport = std::make_tuple(nx, ny);
@@ -459,7 +494,7 @@ class workspace_manager::impl
     output_workarea_manager_t workarea_manager;
 
     impl(output_t *o) :
-        layer_manager(),
+        layer_manager(o),
         viewport_manager(o),
         workarea_manager(o)
     {
@@ -640,6 +675,7 @@ bool workspace_manager::set_workspace_implementation(std::tuple<int, int> ws, st
 void workspace_manager::set_workspace(std::tuple<int, int> ws) { return pimpl->viewport_manager.set_workspace(ws); }
 std::tuple<int, int> workspace_manager::get_current_workspace() { return pimpl->viewport_manager.get_current_workspace(); }
 std::tuple<int, int> workspace_manager::get_workspace_grid_size() { return pimpl->viewport_manager.get_workspace_grid_size(); }
+wf_point workspace_manager::get_viewport_origin() { return pimpl->viewport_manager.get_viewport_origin(); }
 
 void workspace_manager::add_reserved_area(anchored_area *area) { return pimpl->workarea_manager.add_reserved_area(area); }
 void workspace_manager::remove_reserved_area(anchored_area *area) { return pimpl->workarea_manager.remove_reserved_area(area); }
@@ -2,6 +2,8 @@
 #include <debug.hpp>
 #include <core.hpp>
 #include <ctime>
+#include <cmath>
+#include <algorithm>
 
 extern "C"
 {
@@ -322,6 +324,34 @@ uint32_t get_current_time()
     return timespec_to_msec(ts);
 }
 
+void wf::latency_histogram_t::add(int64_t latency_us)
+{
+    int bucket = clamp<int64_t>(latency_us / 1000, 0, BUCKETS - 1);
+    ++buckets[bucket];
+    ++count;
+    total_us += latency_us;
+    max_us = std::max(max_us, latency_us);
+}
+
+double wf::latency_histogram_t::get_average() const
+{
+    return count ? total_us / 1000.0 / count : 0;
+}
+
+int wf::latency_histogram_t::get_percentile(double percentile) const
+{
+    uint64_t target = std::ceil(count * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target && seen > 0)
+            return i + 1;
+    }
+
+    return 0;
+}
+
 wf_geometry clamp(wf_geometry window, wf_geometry output)
 {
     window.width = clamp(window.width, 0, output.width);
@@ -470,7 +500,8 @@ namespace wf
 
     void wl_timer::disconnect()
     {
-        wl_event_source_remove(source);
+        if (source)
+            wl_event_source_remove(source);
         source = NULL;
     }
 
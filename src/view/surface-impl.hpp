@@ -30,6 +30,21 @@ class surface_interface_t::impl
      * subtract_opaque(), send_frame_done(), etc. work for the surface
      */
     wlr_surface *wsurface = nullptr;
+
+    /**
+     * The opaque region of wsurface, as subtracted by the last call of
+     * subtract_opaque(). It is reused as long as the surface hasn't been
+     * committed and the parameters below are the same.
+     */
+    struct
+    {
+        bool valid = false;
+        wf_region region;
+
+        wf_point position;
+        float output_scale;
+        int shrink;
+    } cached_opaque;
 };
 
 /**
@@ -46,7 +61,8 @@ class wlr_surface_base_t
     virtual void damage_surface_box(const wlr_box& box);
     virtual void damage_surface_region(const wf_region& region);
 
-    void apply_surface_damage();
+    /** @return Whether the surface had any damage */
+    bool apply_surface_damage();
     virtual void _wlr_render_box(const wf_framebuffer& fb, int x, int y,
         const wlr_box& scissor);
 
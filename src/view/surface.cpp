@@ -8,14 +8,18 @@ extern "C"
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_presentation_time.h>
 #include <wlr/util/region.h>
+#include <wlr/render/gles2.h>
 #undef static
 }
 
 #include "surface-impl.hpp"
 #include "subsurface.hpp"
 #include "opengl.hpp"
+#include "nonstd/reverse.hpp"
 #include "../core/core-impl.hpp"
+#include "../core/trace.hpp"
 #include "output.hpp"
 #include "debug.hpp"
 #include "render-manager.hpp"
@@ -75,22 +79,40 @@ std::vector<wf::surface_iterator_t> wf::surface_interface_t::enumerate_surfaces(
     wf_point surface_origin)
 {
     std::vector<wf::surface_iterator_t> result;
-    for (auto& child : priv->surface_children)
+    for_each_surface([&] (wf::surface_interface_t *surface, wf_point position) {
+        result.push_back({surface, position});
+    }, surface_origin);
+
+    return result;
+}
+
+void wf::surface_interface_t::visit_surfaces(surface_visit_func_t visit,
+    void *data, wf_point surface_origin, bool reverse)
+{
+    if (reverse && is_mapped())
+        visit(data, this, surface_origin);
+
+    auto visit_child = [&] (surface_interface_t *child)
     {
         if (child->is_mapped())
         {
-            auto child_surfaces = child->enumerate_surfaces(
-                child->get_offset() + surface_origin);
-
-            result.insert(result.end(),
-                child_surfaces.begin(), child_surfaces.end());
+            child->visit_surfaces(visit, data,
+                child->get_offset() + surface_origin, reverse);
         }
-    }
+    };
 
-    if (is_mapped())
-        result.push_back({this, surface_origin});
+    if (reverse)
+    {
+        for (auto& child : wf::reverse(priv->surface_children))
+            visit_child(child);
+    } else
+    {
+        for (auto& child : priv->surface_children)
+            visit_child(child);
+    }
 
-    return result;
+    if (!reverse && is_mapped())
+        visit(data, this, surface_origin);
 }
 
 wf::output_t *wf::surface_interface_t::get_output()
@@ -143,6 +165,13 @@ void wf::surface_interface_t::send_frame_done(const timespec& time)
         wlr_surface_send_frame_done(priv->wsurface, &time);
 }
 
+void wf::surface_interface_t::send_presented(wlr_presentation_event& event)
+{
+    auto presentation = wf::get_core().protocols.presentation;
+    if (priv->wsurface && presentation)
+        wlr_presentation_send_surface_presented(presentation, priv->wsurface, &event);
+}
+
 bool wf::surface_interface_t::accepts_input(int32_t sx, int32_t sy)
 {
     if (!priv->wsurface)
@@ -156,9 +185,19 @@ void wf::surface_interface_t::subtract_opaque(wf_region& region, int x, int y)
     if (!priv->wsurface)
         return;
 
+    auto& cache = priv->cached_opaque;
+    float scale = get_output()->handle->scale;
+    int shrink = get_active_shrink_constraint();
+    if (cache.valid && cache.position == wf_point{x, y} &&
+        cache.output_scale == scale && cache.shrink == shrink)
+    {
+        region ^= cache.region;
+        return;
+    }
+
     wf_region opaque{&priv->wsurface->opaque_region};
     opaque += wf_point{x, y};
-    opaque *= get_output()->handle->scale;
+    opaque *= scale;
 
     /* region scaling uses std::ceil/std::floor, so the resulting region
      * encompasses the opaque region. However, in the case of opaque region, we
@@ -166,11 +205,17 @@ void wf::surface_interface_t::subtract_opaque(wf_region& region, int x, int y)
      * different scales, we just shrink by 1 to compensate for the ceil/floor
      * discrepancy */
     int ceil_factor = 0;
-    if (get_output()->handle->scale != (float)priv->wsurface->current.scale)
+    if (scale != (float)priv->wsurface->current.scale)
         ceil_factor = 1;
 
-    opaque.expand_edges(-get_active_shrink_constraint() - ceil_factor);
+    opaque.expand_edges(-shrink - ceil_factor);
     region ^= opaque;
+
+    cache.valid = true;
+    cache.region = std::move(opaque);
+    cache.position = {x, y};
+    cache.output_scale = scale;
+    cache.shrink = shrink;
 }
 
 wl_client* wf::surface_interface_t::get_client()
@@ -247,6 +292,7 @@ void wf::wlr_surface_base_t::map(wlr_surface *surface)
     this->surface = surface;
 
     _as_si->priv->wsurface = surface;
+    _as_si->priv->cached_opaque.valid = false;
 
     /* force surface_send_enter(), and also check whether parent surface
      * output hasn't changed while we were unmapped */
@@ -314,10 +360,10 @@ void wf::wlr_surface_base_t::damage_surface_box(const wlr_box& box)
     }
 }
 
-void wf::wlr_surface_base_t::apply_surface_damage()
+bool wf::wlr_surface_base_t::apply_surface_damage()
 {
     if (!_as_si->get_output() || !_is_mapped())
-        return;
+        return false;
 
     wf_region dmg;
     wlr_surface_get_effective_damage(surface, dmg.to_pixman());
@@ -327,16 +373,22 @@ void wf::wlr_surface_base_t::apply_surface_damage()
         dmg.expand_edges(1);
 
     damage_surface_region(dmg);
+    return !dmg.empty();
 }
 
 void wf::wlr_surface_base_t::commit()
 {
-    apply_surface_damage();
+    WF_TRACE("surface", "commit");
+    _as_si->priv->cached_opaque.valid = false;
+    bool damaged = apply_surface_damage();
     if (_as_si->get_output())
     {
-        /* we schedule redraw, because the surface might expect
-         * a frame callback */
-        _as_si->get_output()->render->schedule_redraw();
+        /* The surface might expect a frame callback even if nothing changed,
+         * but then the output doesn't need to be repainted for it */
+        if (damaged)
+            _as_si->get_output()->render->schedule_redraw();
+        else
+            _as_si->get_output()->render->schedule_frame_done();
     }
 }
 
@@ -385,14 +437,109 @@ void wf::wlr_surface_base_t::_wlr_render_box(
     OpenGL::render_end();
 }
 
+/** Invert an affine 3x3 matrix, as used by wlr_matrix */
+static void invert_affine_matrix(const float m[9], float inv[9])
+{
+    float det = m[0] * m[4] - m[1] * m[3];
+    inv[0] = m[4] / det;
+    inv[1] = -m[1] / det;
+    inv[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+    inv[3] = -m[3] / det;
+    inv[4] = m[0] / det;
+    inv[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+    inv[6] = inv[7] = 0;
+    inv[8] = 1;
+}
+
+/** Apply an affine 3x3 matrix to the point (x, y) */
+static void transform_point(const float m[9], float x, float y,
+    float& rx, float& ry)
+{
+    rx = m[0] * x + m[1] * y + m[2];
+    ry = m[3] * x + m[4] * y + m[5];
+}
+
 void wf::wlr_surface_base_t::_simple_render(const wf_framebuffer& fb,
     int x, int y, const wf_region& damage)
 {
+    if (!get_buffer())
+        return;
+
+    wlr_gles2_texture_attribs attribs;
+    wlr_gles2_texture_get_attribs(get_buffer()->texture, &attribs);
+
+    bool batch = (attribs.target == GL_TEXTURE_2D);
+#ifdef WAYFIRE_GRAPHICS_DEBUG
+    batch = false;
+#endif
+
+    /* External textures need wlroots' shaders, draw them rect by rect */
+    if (!batch)
+    {
+        for (const auto& rect : damage)
+        {
+            auto box = wlr_box_from_pixman_box(rect);
+            _wlr_render_box(fb, x, y, fb.framebuffer_box_from_damage_box(box));
+        }
+
+        return;
+    }
+
+    wlr_box geometry {x, y, surface->current.width, surface->current.height};
+    geometry = fb.damage_box_from_geometry_box(geometry);
+
+    float projection[9];
+    wlr_matrix_projection(projection, fb.viewport_width, fb.viewport_height,
+        (wl_output_transform)fb.wl_transform);
+
+    /* Maps the texture's unit square to damage coordinates, and back */
+    float identity[9], to_damage[9], to_texture[9];
+    wlr_matrix_identity(identity);
+    wlr_matrix_project_box(to_damage, &geometry,
+        wlr_output_transform_invert(surface->current.transform), 0, identity);
+    invert_affine_matrix(to_damage, to_texture);
+
+    /* Two triangles for each damaged rectangle, clipped to the surface */
+    std::vector<GLfloat> vertex_data;
+    vertex_data.reserve(std::distance(damage.begin(), damage.end()) * 24);
     for (const auto& rect : damage)
     {
-        auto box = wlr_box_from_pixman_box(rect);
-        _wlr_render_box(fb, x, y, fb.framebuffer_box_from_damage_box(box));
+        auto box = wf_geometry_intersection(wlr_box_from_pixman_box(rect),
+            geometry);
+        if (box.width <= 0 || box.height <= 0)
+            continue;
+
+        const float corners[6][2] = {
+            {1.0f * box.x, 1.0f * box.y},
+            {1.0f * box.x + box.width, 1.0f * box.y},
+            {1.0f * box.x + box.width, 1.0f * box.y + box.height},
+            {1.0f * box.x, 1.0f * box.y},
+            {1.0f * box.x + box.width, 1.0f * box.y + box.height},
+            {1.0f * box.x, 1.0f * box.y + box.height},
+        };
+
+        for (auto& corner : corners)
+        {
+            float px, py, u, v;
+            transform_point(projection, corner[0], corner[1], px, py);
+            transform_point(to_texture, corner[0], corner[1], u, v);
+
+            /* wlroots flips the y axis when rendering textures, so that
+             * its projection matches GL's coordinate space */
+            vertex_data.push_back(px);
+            vertex_data.push_back(-py);
+            vertex_data.push_back(u);
+            vertex_data.push_back(attribs.inverted_y ? 1.0f - v : v);
+        }
     }
+
+    if (vertex_data.empty())
+        return;
+
+    OpenGL::render_begin(fb);
+    OpenGL::render_textured_triangles(attribs.tex, vertex_data,
+        attribs.has_alpha);
+    OpenGL::render_end();
 }
 
 wf::wlr_child_surface_base_t::wlr_child_surface_base_t(
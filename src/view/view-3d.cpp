@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <cmath>
 
+#include <glm/matrix.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #define PI 3.14159265359
@@ -181,12 +182,47 @@ wf_3D_view::wf_3D_view(wayfire_view view)
     view_proj = default_proj_matrix() * default_view_matrix();
 }
 
-/* TODO: cache total_transform, because it is often unnecessarily recomputed */
-glm::mat4 wf_3D_view::calculate_total_transform()
+void wf_3D_view::update_cache()
 {
     auto og = view->get_output()->get_relative_geometry();
+    if (cache.output_width == og.width && cache.output_height == og.height &&
+        cache.view_proj == view_proj && cache.translation == translation &&
+        cache.rotation == rotation && cache.scaling == scaling)
+    {
+        return;
+    }
+
+    cache.view_proj = view_proj;
+    cache.translation = translation;
+    cache.rotation = rotation;
+    cache.scaling = scaling;
+    cache.output_width = og.width;
+    cache.output_height = og.height;
+
     glm::mat4 depth_scale = glm::scale(glm::mat4(1.0), {1, 1, 2.0 / std::min(og.width, og.height)});
-    return translation * view_proj * depth_scale * rotation * scaling;
+    cache.total = translation * view_proj * depth_scale * rotation * scaling;
+
+    /* The view lies in the z = 0 plane, so the transform of its points,
+     * followed by the perspective division, is a homography between the
+     * view's plane and the screen. Inverting it is the same as intersecting
+     * the ray through a screen point with the view's plane. */
+    auto& t = cache.total;
+    glm::mat3 homography{
+        t[0][0], t[0][1], t[0][3],
+        t[1][0], t[1][1], t[1][3],
+        t[3][0], t[3][1], t[3][3],
+    };
+
+    /* An edge-on view has no inverse */
+    cache.invertible = std::abs(glm::determinant(homography)) > 1e-9;
+    if (cache.invertible)
+        cache.inverse = glm::inverse(homography);
+}
+
+glm::mat4 wf_3D_view::calculate_total_transform()
+{
+    update_cache();
+    return cache.total;
 }
 
 wf_point wf_3D_view::local_to_transformed_point(wf_geometry geometry, wf_point point)
@@ -201,10 +237,29 @@ wf_point wf_3D_view::local_to_transformed_point(wf_geometry geometry, wf_point p
     return get_absolute_coords_from_relative(geometry, {(int32_t) v.x, (int32_t) v.y});
 }
 
-/* TODO: is there a way to realiably reverse projective transformations? */
 wf_point wf_3D_view::transformed_to_local_point(wf_geometry geometry, wf_point point)
 {
-    return {WF_INVALID_INPUT_COORDINATES, WF_INVALID_INPUT_COORDINATES};
+    update_cache();
+    if (!cache.invertible)
+        return {WF_INVALID_INPUT_COORDINATES, WF_INVALID_INPUT_COORDINATES};
+
+    auto p = get_center_relative_coords(geometry, point);
+    glm::vec3 v = cache.inverse * glm::vec3(1.0f * p.x, 1.0f * p.y, 1.0f);
+    if (std::abs(v.z) < 1e-9)
+        return {WF_INVALID_INPUT_COORDINATES, WF_INVALID_INPUT_COORDINATES};
+
+    v.x /= v.z;
+    v.y /= v.z;
+
+    /* Points behind the camera are projected onto the screen as well, but
+     * they are never visible */
+    auto& t = cache.total;
+    float w = t[0][3] * v.x + t[1][3] * v.y + t[3][3];
+    if (w <= 0)
+        return {WF_INVALID_INPUT_COORDINATES, WF_INVALID_INPUT_COORDINATES};
+
+    return get_absolute_coords_from_relative(geometry,
+        {(int32_t) std::round(v.x), (int32_t) std::round(v.y)});
 }
 
 void wf_3D_view::render_box(uint32_t src_tex, wlr_box src_box,
@@ -17,6 +17,7 @@ extern "C"
 wf::wlr_view_t::wlr_view_t()
     : wf::wlr_surface_base_t(this), wf::view_interface_t()
 {
+    view_impl->viewport_aware = true;
 }
 
 void wf::wlr_view_t::set_role(view_role_t new_role)
@@ -127,10 +128,11 @@ void wf::wlr_view_t::set_position(int x, int y,
     data.view = self();
     data.old_geometry = old_geometry;
 
-    damage_raw(last_bounding_box);
+    damage_last_bounding_box();
     /* obox.x - wm.x is the current difference in the output and wm geometry */
-    geometry.x = x + obox.x - wm.x;
-    geometry.y = y + obox.y - wm.y;
+    auto shift = view_impl->get_viewport_shift();
+    geometry.x = x + obox.x - wm.x + shift.x;
+    geometry.y = y + obox.y - wm.y + shift.y;
 
     /* Make sure that if we move the view while it is unmapped, its snapshot
      * is still valid coordinates */
@@ -145,7 +147,7 @@ void wf::wlr_view_t::set_position(int x, int y,
     if (send_signal)
         emit_signal("geometry-changed", &data);
 
-    last_bounding_box = get_bounding_box();
+    update_last_bounding_box();
 }
 
 void wf::wlr_view_t::move(int x, int y)
@@ -181,7 +183,7 @@ void wf::wlr_view_t::update_size()
     }
 
     /* Damage current size */
-    damage_raw(last_bounding_box);
+    damage_last_bounding_box();
     adjust_anchored_edge(current_size);
 
     view_geometry_changed_signal data;
@@ -192,25 +194,82 @@ void wf::wlr_view_t::update_size()
     geometry.height = current_size.height;
 
     /* Damage new size */
-    last_bounding_box = get_bounding_box();
-    damage_raw(last_bounding_box);
+    update_last_bounding_box();
+    damage_last_bounding_box();
     emit_signal("geometry-changed", &data);
 
     if (view_impl->frame)
         view_impl->frame->notify_view_resized(get_wm_geometry());
 }
 
+void wf::wlr_view_t::damage_last_bounding_box()
+{
+    damage_raw(last_bounding_box + (-view_impl->get_viewport_shift()));
+}
+
+void wf::wlr_view_t::update_last_bounding_box()
+{
+    last_bounding_box = get_bounding_box() + view_impl->get_viewport_shift();
+}
+
+/* How long to wait for a client to apply a configure before sending the
+ * next one anyway */
+static constexpr uint32_t CONFIGURE_TIMEOUT = 200;
+
+void wf::wlr_view_t::throttled_resize(int width, int height)
+{
+    if (configure_in_flight)
+    {
+        has_queued_resize = true;
+        queued_resize = {width, height};
+        return;
+    }
+
+    configure_in_flight = send_resize(width, height);
+    if (configure_in_flight)
+    {
+        configure_timeout.set_timeout(CONFIGURE_TIMEOUT,
+            [=] () { resize_applied(); });
+    }
+}
+
+void wf::wlr_view_t::resize_applied()
+{
+    if (!configure_in_flight)
+        return;
+
+    configure_in_flight = false;
+    configure_timeout.disconnect();
+    if (has_queued_resize)
+    {
+        has_queued_resize = false;
+        throttled_resize(queued_resize.width, queued_resize.height);
+    }
+
+    if (!configure_in_flight)
+    {
+        _view_signal data;
+        data.view = self();
+        emit_signal("resize-done", &data);
+    }
+}
+
+bool wf::wlr_view_t::has_pending_resize()
+{
+    return configure_in_flight;
+}
+
 wf_geometry wf::wlr_view_t::get_output_geometry()
 {
-    return geometry;
+    return geometry + (-view_impl->get_viewport_shift());
 }
 
 wf_geometry wf::wlr_view_t::get_wm_geometry()
 {
     if (view_impl->frame)
-        return view_impl->frame->expand_wm_geometry(geometry);
+        return view_impl->frame->expand_wm_geometry(get_output_geometry());
     else
-        return geometry;
+        return get_output_geometry();
 }
 
 wlr_surface *wf::wlr_view_t::get_keyboard_focus_surface()
@@ -253,7 +312,7 @@ void wf::wlr_view_t::commit()
     if (!view_impl->in_continuous_resize)
         view_impl->edges = 0;
 
-    this->last_bounding_box = get_bounding_box();
+    update_last_bounding_box();
 }
 
 void wf::emit_view_map(wayfire_view view)
@@ -334,6 +393,8 @@ void wf::wlr_view_t::unmap()
 
 void wf::wlr_view_t::destroy()
 {
+    configure_timeout.disconnect();
+    configure_in_flight = has_queued_resize = false;
     view_impl->is_alive = false;
     /* Drop the internal reference created in surface_interface_t */
     unref();
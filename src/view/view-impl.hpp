@@ -59,6 +59,37 @@ class view_interface_t::view_priv_impl
         wf_region cached_damage;
         bool valid() { return this->fb != (uint32_t)-1; }
     } offscreen_buffer;
+    /* The viewport shift at the time the snapshot was taken */
+    wf_point snapshot_shift = {0, 0};
+
+    /**
+     * Views in the middle layers aren't moved when the workspace of their
+     * output changes. Instead, they follow the viewport origin of the output
+     * (see workspace_manager::get_viewport_origin()): the position stored by
+     * the view implementation is its output-local position plus
+     * get_viewport_shift().
+     *
+     * Only view implementations which set viewport_aware do this, other views
+     * are still moved by the workspace manager on each workspace change.
+     */
+    bool viewport_aware = false;
+
+    /** @return The offset from output-local to stored view coordinates */
+    wf_point get_viewport_shift() const;
+
+    /**
+     * Start following the viewport origin of the given output, or stop
+     * following it if output is null. The current shift is preserved, so
+     * that the view doesn't move.
+     */
+    void follow_viewport(wf::output_t *output);
+
+  private:
+    wf::output_t *viewport_output = nullptr;
+    /* The viewport origin at which the shift would be zero */
+    wf_point viewport_base = {0, 0};
+    /* The shift while not following any output */
+    wf_point frozen_shift = {0, 0};
 };
 
 /**
@@ -90,6 +121,7 @@ class wlr_view_t :
     virtual wf_geometry get_output_geometry() override;
 
     virtual wlr_surface *get_keyboard_focus_surface() override;
+    virtual bool has_pending_resize() override;
 
     virtual bool should_be_decorated() override;
     virtual void set_output(wf::output_t*) override;
@@ -114,6 +146,10 @@ class wlr_view_t :
      * calculate the old view region to damage.
      */
     wf_geometry last_bounding_box {0, 0, 0, 0};
+    /* last_bounding_box is stored with the viewport shift, so that it
+     * remains valid when the workspace changes */
+    void damage_last_bounding_box();
+    void update_last_bounding_box();
 
     /**
      * Adjust the view position when resizing the view so that its apparent
@@ -121,7 +157,8 @@ class wlr_view_t :
      */
     void adjust_anchored_edge(wf_surface_size_t new_size);
 
-    /** The output geometry of the view */
+    /** The output geometry of the view, shifted by the viewport shift, see
+     * view_priv_impl::get_viewport_shift() */
     wf_geometry geometry {100, 100, 0, 0};
 
     /** Set the view position and optionally send the geometry changed signal
@@ -132,6 +169,32 @@ class wlr_view_t :
     /** Update the view size to the actual dimensions of its surface */
     virtual void update_size();
 
+    /**
+     * Resize the view, keeping at most one configure in flight, see
+     * view_interface_t::has_pending_resize().
+     */
+    void throttled_resize(int width, int height);
+
+    /**
+     * Send a configure with the given size to the client.
+     *
+     * @return true if the client has to apply a configure, false if nothing
+     * was sent, for ex. because the size didn't change.
+     */
+    virtual bool send_resize(int width, int height) { return false; }
+
+    /**
+     * Called by the shell implementations when the client has applied the
+     * configure in flight. Sends the queued size, if any.
+     */
+    void resize_applied();
+
+    bool configure_in_flight = false;
+    bool has_queued_resize = false;
+    wf_surface_size_t queued_resize;
+    /* Clients which don't apply a configure in time are no longer waited for */
+    wf::wl_timer configure_timeout;
+
     virtual void commit() override;
     virtual void map(wlr_surface *surface) override;
     virtual void unmap() override;
@@ -1,5 +1,6 @@
 #include "debug.hpp"
 #include "../core/core-impl.hpp"
+#include "../core/trace.hpp"
 #include "view-impl.hpp"
 #include "opengl.hpp"
 #include "output.hpp"
@@ -151,6 +152,11 @@ void wf::view_interface_t::request_native_size()
     /* no-op */
 }
 
+bool wf::view_interface_t::has_pending_resize()
+{
+    return false;
+}
+
 void wf::view_interface_t::close()
 {
     /* no-op */
@@ -222,16 +228,23 @@ wf::surface_interface_t *wf::view_interface_t::map_input_coordinates(
     auto view_relative_coordinates =
         global_to_local_point({cursor_x, cursor_y}, nullptr);
 
-    for (auto& child : enumerate_surfaces({0, 0}))
+    wf::surface_interface_t *result = nullptr;
+    for_each_surface([&] (wf::surface_interface_t *surface, wf_point position)
     {
-        sx = view_relative_coordinates.x - child.position.x;
-        sy = view_relative_coordinates.y - child.position.y;
+        if (result)
+            return;
 
-        if (child.surface->accepts_input(sx, sy))
-            return child.surface;
-    }
+        int x = view_relative_coordinates.x - position.x;
+        int y = view_relative_coordinates.y - position.y;
+        if (surface->accepts_input(x, y))
+        {
+            result = surface;
+            sx = x;
+            sy = y;
+        }
+    });
 
-    return nullptr;
+    return result;
 }
 
 bool wf::view_interface_t::is_focuseable() const
@@ -575,17 +588,21 @@ bool wf::view_interface_t::has_transformer()
 wf_geometry wf::view_interface_t::get_untransformed_bounding_box()
 {
     if (!is_mapped())
-        return view_impl->offscreen_buffer.geometry;
+    {
+        /* The workspace may have changed since the snapshot was taken */
+        return view_impl->offscreen_buffer.geometry +
+            view_impl->snapshot_shift +
+            (-view_impl->get_viewport_shift());
+    }
 
     auto bbox = get_output_geometry();
     wf_region bounding_region = bbox;
 
-    for (auto& child : enumerate_surfaces({bbox.x, bbox.y}))
+    for_each_surface([&] (wf::surface_interface_t *surface, wf_point position)
     {
-        auto dim = child.surface->get_size();
-        bounding_region |= {child.position.x, child.position.y,
-            dim.width, dim.height};
-    };
+        auto dim = surface->get_size();
+        bounding_region |= {position.x, position.y, dim.width, dim.height};
+    }, {bbox.x, bbox.y});
 
     return wlr_box_from_pixman_box(bounding_region.get_extents());
 }
@@ -641,18 +658,19 @@ bool wf::view_interface_t::intersects_region(const wlr_box& region)
     if (!is_mapped())
         return region & get_bounding_box();
 
+    bool intersects = false;
     auto origin = get_output_geometry();
-    for (auto& child : enumerate_surfaces({origin.x, origin.y}))
+    for_each_surface([&] (wf::surface_interface_t *surface, wf_point position)
     {
-        wlr_box box = {child.position.x, child.position.y,
-            child.surface->get_size().width, child.surface->get_size().height};
-        box = transform_region(box);
+        if (intersects)
+            return;
 
-        if (region & box)
-            return true;
-    }
+        auto dim = surface->get_size();
+        wlr_box box = {position.x, position.y, dim.width, dim.height};
+        intersects = region & transform_region(box);
+    }, {origin.x, origin.y});
 
-    return false;
+    return intersects;
 }
 
 bool wf::view_interface_t::render_transformed(const wf_framebuffer& framebuffer,
@@ -693,6 +711,8 @@ bool wf::view_interface_t::render_transformed(const wf_framebuffer& framebuffer,
             return;
         }
 
+        WF_TRACE("view", "transformer render");
+
         /* Calculate size after this transform */
         auto transformed_box =
             transform->transform->get_bounding_box(obox, obox);
@@ -745,6 +765,7 @@ bool wf::view_interface_t::render_transformed(const wf_framebuffer& framebuffer,
     {
         /* Regular case, just call the last transformer, but render directly
          * to the target framebuffer */
+        WF_TRACE("view", "transformer render");
         final_transform->transform->render_with_damage(previous_texture, obox,
             damage, framebuffer);
     }
@@ -760,6 +781,20 @@ wf::view_transform_block_t::~view_transform_block_t()
     OpenGL::render_end();
 }
 
+/** Allocate the framebuffer for the given geometry and clear it */
+static void prepare_snapshot(wf_framebuffer& framebuffer,
+    wf_geometry geometry, float scale)
+{
+    framebuffer.geometry = geometry;
+    framebuffer.scale = scale;
+
+    OpenGL::render_begin();
+    framebuffer.allocate(geometry.width * scale, geometry.height * scale);
+    framebuffer.bind();
+    OpenGL::clear({0, 0, 0, 0});
+    OpenGL::render_end();
+}
+
 void wf::view_interface_t::take_snapshot()
 {
     if (!is_mapped())
@@ -769,6 +804,7 @@ void wf::view_interface_t::take_snapshot()
 
     auto buffer_geometry = get_untransformed_bounding_box();
     offscreen_buffer.geometry = buffer_geometry;
+    view_impl->snapshot_shift = view_impl->get_viewport_shift();
 
     float scale = get_output()->handle->scale;
 
@@ -778,15 +814,7 @@ void wf::view_interface_t::take_snapshot()
 
     /* TODO: use offscreen buffer better */
     offscreen_buffer.cached_damage.clear();
-
-    OpenGL::render_begin();
-    offscreen_buffer.allocate(buffer_geometry.width * scale,
-        buffer_geometry.height * scale);
-
-    offscreen_buffer.scale = scale;
-    offscreen_buffer.bind();
-    OpenGL::clear({0, 0, 0, 0});
-    OpenGL::render_end();
+    prepare_snapshot(offscreen_buffer, buffer_geometry, scale);
 
     wf_region full_region{{0, 0, offscreen_buffer.viewport_width,
         offscreen_buffer.viewport_height}};
@@ -795,11 +823,44 @@ void wf::view_interface_t::take_snapshot()
     int ox = output_geometry.x - buffer_geometry.x;
     int oy = output_geometry.y - buffer_geometry.y;
 
-    auto children = enumerate_surfaces({ox, oy});
-    for (auto& child : wf::reverse(children))
+    for_each_surface([&] (wf::surface_interface_t *surface, wf_point position)
+    {
+        surface->simple_render(offscreen_buffer, position.x, position.y,
+            full_region);
+    }, {ox, oy}, true);
+}
+
+void wf::view_interface_t::render_snapshot(wf_framebuffer& framebuffer)
+{
+    prepare_snapshot(framebuffer, get_bounding_box(),
+        get_output()->handle->scale);
+    render_transformed(framebuffer, framebuffer.get_damage_region());
+}
+
+wf_point wf::view_interface_t::view_priv_impl::get_viewport_shift() const
+{
+    if (!viewport_output)
+        return frozen_shift;
+
+    auto origin = viewport_output->workspace->get_viewport_origin();
+    return {origin.x - viewport_base.x, origin.y - viewport_base.y};
+}
+
+void wf::view_interface_t::view_priv_impl::follow_viewport(
+    wf::output_t *output)
+{
+    if (!viewport_aware || output == viewport_output)
+        return;
+
+    auto shift = get_viewport_shift();
+    viewport_output = output;
+    if (output)
+    {
+        auto origin = output->workspace->get_viewport_origin();
+        viewport_base = {origin.x - shift.x, origin.y - shift.y};
+    } else
     {
-        child.surface->simple_render(offscreen_buffer,
-            child.position.x, child.position.y, full_region);
+        frozen_shift = shift;
     }
 }
 
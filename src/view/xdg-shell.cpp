@@ -223,6 +223,15 @@ void wayfire_xdg_view<XdgToplevelVersion>::commit()
 {
     wlr_view_t::commit();
 
+    /* The client acks a configure and then commits the new state. Serials
+     * are increasing, so a newer configure which has been acked includes
+     * the size sent with resize_serial. */
+    if (configure_in_flight &&
+        int32_t(xdg_toplevel->base->configure_serial - resize_serial) >= 0)
+    {
+        resize_applied();
+    }
+
     /* On each commit, check whether the window geometry of the xdg_surface
      * changed. In those cases, we need to adjust the view's output geometry,
      * so that the apparent wm geometry doesn't change */
@@ -330,20 +339,27 @@ void wayfire_xdg_view<wlr_xdg_toplevel_v6>::set_fullscreen(bool full)
     wlr_xdg_toplevel_v6_set_fullscreen(xdg_toplevel->base, full);
 }
 
-template<>
-void wayfire_xdg_view<wlr_xdg_toplevel>::resize(int w, int h)
+template<class XdgToplevelVersion>
+void wayfire_xdg_view<XdgToplevelVersion>::resize(int w, int h)
 {
     if (view_impl->frame)
         view_impl->frame->calculate_resize_size(w, h);
-    wlr_xdg_toplevel_set_size(xdg_toplevel->base, w, h);
+    throttled_resize(w, h);
 }
 
 template<>
-void wayfire_xdg_view<wlr_xdg_toplevel_v6>::resize(int w, int h)
+bool wayfire_xdg_view<wlr_xdg_toplevel>::send_resize(int w, int h)
 {
-    if (view_impl->frame)
-        view_impl->frame->calculate_resize_size(w, h);
-    wlr_xdg_toplevel_v6_set_size(xdg_toplevel->base, w, h);
+    /* wlroots doesn't send a configure if the size didn't change */
+    resize_serial = wlr_xdg_toplevel_set_size(xdg_toplevel->base, w, h);
+    return resize_serial != 0;
+}
+
+template<>
+bool wayfire_xdg_view<wlr_xdg_toplevel_v6>::send_resize(int w, int h)
+{
+    resize_serial = wlr_xdg_toplevel_v6_set_size(xdg_toplevel->base, w, h);
+    return resize_serial != 0;
 }
 
 template<>
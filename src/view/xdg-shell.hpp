@@ -49,6 +49,11 @@ class wayfire_xdg_view : public wf::wlr_view_t
 
     wf_point xdg_surface_offset = {0, 0};
     XdgToplevelVersion *xdg_toplevel;
+    /* The serial of the last configure sent by send_resize() */
+    uint32_t resize_serial = 0;
+
+  protected:
+    bool send_resize(int width, int height) final;
 
   public:
     wayfire_xdg_view(XdgToplevelVersion *toplevel);
@@ -36,7 +36,21 @@ class wayfire_xwayland_view_base : public wf::wlr_view_t
         [this] (wf::signal_data_t*)
     {
         if (is_mapped())
-            move(geometry.x, geometry.y);
+        {
+            auto og = get_output_geometry();
+            move(og.x, og.y);
+        }
+    };
+
+    /* Views aren't moved when the workspace changes, so X keeps the
+     * positions of the views from the time they were last configured. They
+     * matter only for visible views, for ex. for positioning menus, so
+     * update just those instead of configuring all views. */
+    wf::signal_callback_t viewport_changed = [this] (wf::signal_data_t*)
+    {
+        auto ws = get_output()->workspace->get_current_workspace();
+        if (is_mapped() && get_output()->workspace->view_visible_on(self(), ws))
+            send_configure();
     };
 
     public:
@@ -75,6 +89,8 @@ class wayfire_xwayland_view_base : public wf::wlr_view_t
         {
             get_output()->disconnect_signal(
                 "output-configuration-changed", &output_geometry_changed);
+            get_output()->disconnect_signal("viewport-changed",
+                &viewport_changed);
         }
 
         on_map.disconnect();
@@ -168,6 +184,8 @@ class wayfire_xwayland_view_base : public wf::wlr_view_t
         {
             get_output()->disconnect_signal("output-configuration-changed",
                 &output_geometry_changed);
+            get_output()->disconnect_signal("viewport-changed",
+                &viewport_changed);
         }
 
         wlr_view_t::set_output(wo);
@@ -176,6 +194,7 @@ class wayfire_xwayland_view_base : public wf::wlr_view_t
         {
             wo->connect_signal("output-configuration-changed",
                 &output_geometry_changed);
+            wo->connect_signal("viewport-changed", &viewport_changed);
         }
         /* Update the real position */
         send_configure();
@@ -296,6 +315,10 @@ class wayfire_xwayland_view : public wayfire_xwayland_view_base
          * compositor keeps trying to resize it */
         last_server_width = geometry.width;
         last_server_height = geometry.height;
+
+        /* X has no configure acks. Clients redraw after a ConfigureNotify,
+         * so the first commit after it is taken as the client's response. */
+        resize_applied();
     }
 
     virtual bool should_be_decorated() override
@@ -325,10 +348,15 @@ class wayfire_xwayland_view : public wayfire_xwayland_view_base
     {
         if (view_impl->frame)
             view_impl->frame->calculate_resize_size(w, h);
+        throttled_resize(w, h);
+    }
 
+    bool send_resize(int w, int h) override
+    {
         last_server_width = w;
         last_server_height = h;
         send_configure(w, h);
+        return is_mapped();
     }
 
     virtual void request_native_size() override
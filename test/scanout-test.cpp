@@ -0,0 +1,169 @@
+#include "../src/output/scanout.hpp"
+#include <cstdio>
+#include <cstring>
+
+/* A fullscreen view which can be scanned out. Each case changes it a bit. */
+static wf::scanout_state_t get_eligible_state()
+{
+    wf::scanout_state_t state;
+    state.output_geometry = {0, 0, 1920, 1080};
+    state.output_scale = 1.0;
+    state.output_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+
+    state.has_view = true;
+    state.view_fullscreen = true;
+    state.view_opaque = true;
+    state.view_surface_count = 1;
+    state.view_geometry = {0, 0, 1920, 1080};
+
+    state.has_buffer = true;
+    state.buffer_scale = 1;
+    state.buffer_transform = WL_OUTPUT_TRANSFORM_NORMAL;
+    return state;
+}
+
+struct test_case_t
+{
+    const char *name;
+    void (*change)(wf::scanout_state_t& state);
+    wf::scanout_result_t expected;
+};
+
+static const test_case_t test_cases[] = {
+    {"eligible", [] (wf::scanout_state_t&) {}, wf::SCANOUT_OK},
+    {"hidpi", [] (wf::scanout_state_t& s) {
+        s.output_scale = 2.0;
+        s.buffer_scale = 2;
+    }, wf::SCANOUT_OK},
+    {"rotated", [] (wf::scanout_state_t& s) {
+        s.output_transform = WL_OUTPUT_TRANSFORM_90;
+        s.buffer_transform = WL_OUTPUT_TRANSFORM_90;
+    }, wf::SCANOUT_OK},
+
+    {"custom renderer", [] (wf::scanout_state_t& s) {
+        s.custom_renderer = true;
+    }, wf::SCANOUT_CUSTOM_RENDERER},
+    {"overlay effects", [] (wf::scanout_state_t& s) {
+        s.has_overlay_effects = true;
+    }, wf::SCANOUT_EFFECTS},
+    {"post effects", [] (wf::scanout_state_t& s) {
+        s.has_post_effects = true;
+    }, wf::SCANOUT_EFFECTS},
+    {"inhibited", [] (wf::scanout_state_t& s) {
+        s.inhibited = true;
+    }, wf::SCANOUT_INHIBITED},
+    {"software cursor", [] (wf::scanout_state_t& s) {
+        s.software_cursor = true;
+    }, wf::SCANOUT_SOFTWARE_CURSOR},
+    {"drag icon", [] (wf::scanout_state_t& s) {
+        s.drag_icon = true;
+    }, wf::SCANOUT_DRAG_ICON},
+    {"viewport scrolled", [] (wf::scanout_state_t& s) {
+        s.viewport_scrolled = true;
+    }, wf::SCANOUT_VIEWPORT_SCROLLED},
+
+    {"no view", [] (wf::scanout_state_t& s) {
+        s.has_view = false;
+    }, wf::SCANOUT_NO_VIEW},
+    {"no buffer", [] (wf::scanout_state_t& s) {
+        s.has_buffer = false;
+    }, wf::SCANOUT_NO_VIEW},
+    {"not fullscreen", [] (wf::scanout_state_t& s) {
+        s.view_fullscreen = false;
+    }, wf::SCANOUT_NOT_FULLSCREEN},
+    {"transformed", [] (wf::scanout_state_t& s) {
+        s.view_transformed = true;
+    }, wf::SCANOUT_TRANSFORMED},
+    {"not opaque", [] (wf::scanout_state_t& s) {
+        s.view_opaque = false;
+    }, wf::SCANOUT_NOT_OPAQUE},
+    {"subsurfaces", [] (wf::scanout_state_t& s) {
+        s.view_surface_count = 2;
+    }, wf::SCANOUT_SUBSURFACES},
+    {"view offset", [] (wf::scanout_state_t& s) {
+        s.view_geometry.x = 10;
+    }, wf::SCANOUT_GEOMETRY_MISMATCH},
+    {"view smaller", [] (wf::scanout_state_t& s) {
+        s.view_geometry.height = 1000;
+    }, wf::SCANOUT_GEOMETRY_MISMATCH},
+    {"buffer scale", [] (wf::scanout_state_t& s) {
+        s.output_scale = 2.0;
+    }, wf::SCANOUT_BUFFER_MISMATCH},
+    {"fractional scale", [] (wf::scanout_state_t& s) {
+        s.output_scale = 1.5;
+        s.buffer_scale = 2;
+    }, wf::SCANOUT_BUFFER_MISMATCH},
+    {"buffer transform", [] (wf::scanout_state_t& s) {
+        s.buffer_transform = WL_OUTPUT_TRANSFORM_180;
+    }, wf::SCANOUT_BUFFER_MISMATCH},
+
+    /* The first reason in the order of the checks is reported */
+    {"output before view", [] (wf::scanout_state_t& s) {
+        s.software_cursor = true;
+        s.view_fullscreen = false;
+    }, wf::SCANOUT_SOFTWARE_CURSOR},
+    {"custom renderer first", [] (wf::scanout_state_t& s) {
+        s.custom_renderer = true;
+        s.has_post_effects = true;
+        s.has_view = false;
+    }, wf::SCANOUT_CUSTOM_RENDERER},
+};
+
+int main()
+{
+    int failed = 0;
+    for (auto& test : test_cases)
+    {
+        auto state = get_eligible_state();
+        test.change(state);
+
+        auto result = wf::check_scanout(state);
+        if (result != test.expected)
+        {
+            std::printf("FAIL %s: expected \"%s\", got \"%s\"\n", test.name,
+                wf::scanout_result_to_string(test.expected),
+                wf::scanout_result_to_string(result));
+            ++failed;
+        }
+    }
+
+    for (int i = wf::SCANOUT_OK; i <= wf::SCANOUT_BUFFER_MISMATCH; i++)
+    {
+        auto name = wf::scanout_result_to_string(wf::scanout_result_t(i));
+        if (!std::strcmp(name, "unknown"))
+        {
+            std::printf("FAIL result %d has no description\n", i);
+            ++failed;
+        }
+    }
+
+    /* An unchanged buffer which is already scanned out must not be
+     * committed (and counted as a new frame) again */
+    struct frame_case_t
+    {
+        bool scanout_active;
+        bool damaged;
+        wf::scanout_frame_t expected;
+    };
+
+    static const frame_case_t frame_cases[] = {
+        {false, false, wf::SCANOUT_FRAME_COMMIT},
+        {false, true, wf::SCANOUT_FRAME_COMMIT},
+        {true, true, wf::SCANOUT_FRAME_COMMIT},
+        {true, false, wf::SCANOUT_FRAME_UNCHANGED},
+    };
+
+    for (auto& test : frame_cases)
+    {
+        auto frame = wf::get_scanout_frame(test.scanout_active, test.damaged);
+        if (frame != test.expected)
+        {
+            std::printf("FAIL frame active=%d damaged=%d: expected %d, got %d\n",
+                test.scanout_active, test.damaged, test.expected, frame);
+            ++failed;
+        }
+    }
+
+    std::printf("%d failed\n", failed);
+    return failed ? 1 : 0;
+}